@@ -0,0 +1,9 @@
+#!/bin/sh
+set -e
+
+mkdir -p build
+
+CFLAGS="-std=c23 -g -Wno-static-in-inline"
+LFLAGS=""
+
+clang $CFLAGS -o build/code code/code.c $LFLAGS
@@ -2,6 +2,7 @@
 
 #include "code_parser.c"
 
+#if defined(CODE_ON_PLATFORM_WIN32)
 struct
 {
 	HINSTANCE    instance;
@@ -11,23 +12,41 @@ struct
 
 	uintl performance_frequency;
 } win32;
+#endif
 
 int main(int arguments_count, char *arguments[])
 {
 	setlocale(LC_CTYPE, "");
 	/* initialize platform-specific stuff */
 	{
+#if defined(CODE_ON_PLATFORM_WIN32)
 		win32.instance = GetModuleHandle(0);
 		GetStartupInfoW(&win32.startup_info);
 
 		win32.command_line = GetCommandLineW();
 		base.command_line_size = make_utf8_text_from_utf16(0, win32.command_line);
-		base.command_line = push(base.command_line_size + 1, universal_alignment, &base.persistent_allocator);
+		base.command_line = push_uninitialized(base.command_line_size + 1, universal_alignment, &base.persistent_allocator);
 		make_utf8_text_from_utf16(base.command_line, win32.command_line);
 
 		LARGE_INTEGER frequency;
 		QueryPerformanceFrequency(&frequency);
 		win32.performance_frequency = frequency.QuadPart;
+#elif defined(CODE_ON_PLATFORM_LINUX)
+		/* there's no command line on linux, so join the arguments back into one */
+		base.command_line_size = 0;
+		for (sint i = 0; i < arguments_count; ++i) base.command_line_size += get_size_of_utf8_text(arguments[i]) + 1;
+		base.command_line = push_uninitialized(base.command_line_size, universal_alignment, &base.persistent_allocator);
+		utf8 *caret = base.command_line;
+		for (sint i = 0; i < arguments_count; ++i)
+		{
+			uint size = get_size_of_utf8_text(arguments[i]);
+			copy(caret, arguments[i], size);
+			caret += size;
+			*caret++ = ' ';
+		}
+		base.command_line_size -= 1;
+		base.command_line[base.command_line_size] = 0;
+#endif
 	}
 
 	context.failure_landing = &context.default_failure_landing;
@@ -36,38 +55,80 @@ int main(int arguments_count, char *arguments[])
 		UNIMPLEMENTED();
 	}
 	
+	const utf8 *source_path = 0;
+	parser_options options = {0};
+	bit reports_statistics_as_line = 0;
+	for (sint i = 1; i < arguments_count; ++i)
+	{
+		const utf8 *argument = arguments[i];
+		if (!compare_text(argument, "--stats"))
+		{
+			options.collects_statistics = 1;
+		}
+		else if (!compare_text(argument, "--stats=line"))
+		{
+			options.collects_statistics = 1;
+			reports_statistics_as_line = 1;
+		}
+		else if (!compare_text(argument, "--pretokenize"))
+		{
+			options.pretokenizes = 1;
+		}
+		else if (!compare_text(argument, "--pipeline"))
+		{
+			options.pipelines = 1;
+		}
+		else if (!compare_text(argument, "--compact"))
+		{
+			options.compacts = 1;
+		}
+		else if (!compare_sized_text(argument, "--trace=", 8))
+		{
+			start_tracing(argument + 8);
+		}
+		else if (argument[0] == '-' && argument[1] == '-')
+		{
+			REPORT_FAILURE("Unknown option: %s\n", argument);
+			return -1;
+		}
+		else source_path = argument;
+	}
+
 	program program;
 
-	if (arguments_count <= 1)
+	if (!source_path)
 	{
 		REPORT_FAILURE("A source path wasn't given.");
 		return -1;
 	}
 
 	parser parser;
-	parser_parse(arguments[1], &program, &parser);
+	parser_parse(source_path, options, &program, &parser);
+	if (options.collects_statistics) parser_report_statistics(&parser, reports_statistics_as_line);
+	program_release(&program);
+	parser_release(&parser);
 }
 
 /* math */
 
-inline address get_backward_alignment(address address, uintb alignment)
+inline address get_backward_alignment(address address, uint alignment)
 {
 	if (alignment == 1) alignment = 0;
 	return alignment ? address & (alignment - 1) : 0;
 }
 
-inline address get_forward_alignment(address address, uintb alignment)
+inline address get_forward_alignment(address address, uint alignment)
 {
 	uintl remainder = get_backward_alignment(address, alignment);
 	return remainder ? alignment - remainder : 0;
 }
 
-inline address align_forward(address address, uintb alignment)
+inline address align_forward(address address, uint alignment)
 {
 	return address + get_forward_alignment(address, alignment);
 }
 
-inline address align_backward(address address, uintb alignment)
+inline address align_backward(address address, uint alignment)
 {
 	return address - get_backward_alignment(address, alignment);
 }
@@ -92,27 +153,27 @@ inline void zero(void *left, uint size)
 	fill(left, size, 0);
 }
 
-inline uintb clz(uintl value)
+static inline uintb clz(uintl value)
 {
 #if defined(CODE_ON_PLATFORM_WIN32)
   unsigned long index;
   if (!_BitScanReverse64(&index, value))
     return sizeof(value) * byte_bits_count;
   return sizeof(value) * byte_bits_count - index - 1;
-#elif defined(ON_LINUX)
-  return __builtin_clz(value);
+#elif defined(CODE_ON_PLATFORM_LINUX)
+  return value ? __builtin_clzll(value) : sizeof(value) * byte_bits_count;
 #endif
 }
 
-inline uintb ctz(uintl value)
+static inline uintb ctz(uintl value)
 {
 #if defined(CODE_ON_PLATFORM_WIN32)
   unsigned long index;
   if (!_BitScanForward64(&index, value))
     return sizeof(value) * byte_bits_count;
   return index;
-#elif defined(ON_LINUX)
-  return __builtin_ctz(value);
+#elif defined(CODE_ON_PLATFORM_LINUX)
+  return value ? __builtin_ctzll(value) : sizeof(value) * byte_bits_count;
 #endif
 }
 
@@ -246,6 +307,166 @@ sintb decode_utf8(utf32 *left, const utf8 *right)
 	return increment;
 }
 
+/* for text that passed validate_utf8 */
+inline uintb decode_valid_utf8(utf32 *left, const utf8 *right)
+{
+	byte lead = right[0];
+	if (LIKELY(lead < 0x80))
+	{
+		*left = lead;
+		return 1;
+	}
+	else if (lead < 0xE0)
+	{
+		*left = ((lead     & lmask5) << 6)
+			  | ((right[1] & lmask6) << 0);
+		return 2;
+	}
+	else if (lead < 0xF0)
+	{
+		*left = ((lead     & lmask4) << 12)
+			  | ((right[1] & lmask6) <<  6)
+			  | ((right[2] & lmask6) <<  0);
+		return 3;
+	}
+	else
+	{
+		*left = ((lead     & lmask3) << 18)
+			  | ((right[1] & lmask6) << 12)
+			  | ((right[2] & lmask6) <<  6)
+			  | ((right[3] & lmask6) <<  0);
+		return 4;
+	}
+}
+
+/* from a lead, or from the bytes after a whole sequence */
+static uint validate_utf8_by_byte(const byte *bytes, uint index, uint size)
+{
+	while (index < size)
+	{
+		while (index < size && bytes[index] < 0x80) index += 1;
+		if (index == size) break;
+
+		/* the ranges of the second byte depend on the first, the rest are plain continuations */
+		byte lead = bytes[index];
+		uint increment;
+		byte minimum = 0x80;
+		byte maximum = 0xBF;
+		if (lead >= 0xC2 && lead <= 0xDF) increment = 2;
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			increment = 3;
+			if (lead == 0xE0) minimum = 0xA0;
+			if (lead == 0xED) maximum = 0x9F;
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			increment = 4;
+			if (lead == 0xF0) minimum = 0x90;
+			if (lead == 0xF4) maximum = 0x8F;
+		}
+		else return index;
+
+		if (increment > size - index) return index;
+		if (bytes[index + 1] < minimum || bytes[index + 1] > maximum) return index;
+		for (uint i = 2; i < increment; ++i)
+		{
+			if ((bytes[index + i] & 0xC0) != 0x80) return index;
+		}
+		index += increment;
+	}
+	return size;
+}
+
+#if defined(VECTOR_SIZE)
+/* of a block of 64 bytes, a bit each */
+typedef struct
+{
+	uintl leads;      /* of two bytes or more */
+	uintl long_leads; /* of three bytes or more */
+	uintl lead4s;
+	uintl e0s, eds, f0s, f4s;
+} utf8_leads;
+
+/* the bytes from before a block that was checked, back to the lead of the sequence that the block cuts */
+static uint get_utf8_sequence_beginning(const byte *bytes, uint index)
+{
+	for (uint back = 1; back <= 3 && back <= index; ++back)
+	{
+		byte previous = bytes[index - back];
+		if (previous < 0x80) break;
+		if (previous >= 0xC0)
+		{
+			if (previous >= (back == 1 ? 0xC0 : back == 2 ? 0xE0 : 0xF0)) index -= back;
+			break;
+		}
+	}
+	return index;
+}
+#endif
+
+/* unlike decode_utf8, this also refuses overlong forms, surrogates, and runes beyond U+10FFFF */
+uint validate_utf8(const utf8 *text, uint size)
+{
+	const byte *bytes = (const byte *)text;
+	uint index = 0;
+#if defined(VECTOR_SIZE)
+	/* 
+		64 bytes at a time, as bit masks of their classes. a continuation has to be exactly where a lead
+		wants one, and the bytes after E0, ED, F0 and F4 have narrower ranges. the leads at the end of a
+		block are shifted into the next. a malformed block is gone over by byte, for the exact offset.
+	*/
+	utf8_leads previous = {};
+	for (; index + 64 <= size; index += 64)
+	{
+		vector any = VECTOR_LOAD(bytes + index);
+		for (uint offset = VECTOR_SIZE; offset < 64; offset += VECTOR_SIZE) any = VECTOR_OR(any, VECTOR_LOAD(bytes + index + offset));
+		bit is_continued = ((previous.leads >> 63) | (previous.long_leads >> 62) | (previous.lead4s >> 61)) != 0;
+		if (LIKELY(!VECTOR_MASK(any) && !is_continued))
+		{
+			previous = (utf8_leads){};
+			continue;
+		}
+
+		utf8_leads current = {};
+		uintl non_ascii     = 0;
+		uintl continuations = 0;
+		uintl below_a0 = 0; /* continuations of 80 to 9F */
+		uintl below_90 = 0; /* continuations of 80 to 8F */
+		for (uint offset = 0; offset < 64; offset += VECTOR_SIZE)
+		{
+			vector x = VECTOR_LOAD(bytes + index + offset);
+			non_ascii          |= (uintl)VECTOR_MASK(x) << offset;
+			continuations      |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0x80, 0xBF)) << offset;
+			below_a0           |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0x80, 0x9F)) << offset;
+			below_90           |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0x80, 0x8F)) << offset;
+			current.leads      |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0xC2, 0xF4)) << offset;
+			current.long_leads |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0xE0, 0xF4)) << offset;
+			current.lead4s     |= (uintl)VECTOR_MASK(VECTOR_IN_RANGE(x, 0xF0, 0xF4)) << offset;
+			current.e0s        |= (uintl)VECTOR_MASK(VECTOR_EQUAL(x, VECTOR_SPLAT(0xE0))) << offset;
+			current.eds        |= (uintl)VECTOR_MASK(VECTOR_EQUAL(x, VECTOR_SPLAT(0xED))) << offset;
+			current.f0s        |= (uintl)VECTOR_MASK(VECTOR_EQUAL(x, VECTOR_SPLAT(0xF0))) << offset;
+			current.f4s        |= (uintl)VECTOR_MASK(VECTOR_EQUAL(x, VECTOR_SPLAT(0xF4))) << offset;
+		}
+
+		#define SHIFT_IN(leads, count) ((current.leads << (count)) | (previous.leads >> (64 - (count))))
+		uintl wanted_continuations = SHIFT_IN(leads, 1) | SHIFT_IN(long_leads, 2) | SHIFT_IN(lead4s, 3);
+		uintl malformations = (wanted_continuations ^ continuations)
+			| (non_ascii & ~(continuations | current.leads))
+			| (SHIFT_IN(e0s, 1) & below_a0)
+			| (SHIFT_IN(eds, 1) & continuations & ~below_a0)
+			| (SHIFT_IN(f0s, 1) & below_90)
+			| (SHIFT_IN(f4s, 1) & continuations & ~below_90);
+		#undef SHIFT_IN
+
+		if (malformations) return validate_utf8_by_byte(bytes, get_utf8_sequence_beginning(bytes, index), size);
+		previous = current;
+	}
+	index = get_utf8_sequence_beginning(bytes, index);
+#endif
+	return validate_utf8_by_byte(bytes, index, size);
+}
+
 sintb decode_utf16(utf32 *left, const utf16 *right)
 {
 	*left = *right;
@@ -299,7 +520,7 @@ sintb encode_utf8(utf8 *left, utf32 right)
 
 sintb encode_utf16(utf16 *left, utf32 right)
 {
-	byte buffer[2];
+	utf16 buffer[2];
 	sintb increment = 0;
 	if (right < 0x10000)
 	{
@@ -382,142 +603,1438 @@ inline void copy_sized_text(utf8 *left, const utf8 *right, uint size)
 	__builtin_strncpy(left, right, size);
 }
 
-#define STB_SPRINTF_IMPLEMENTATION
-#include <stb/stb_sprintf.h>
+/* symbols */
 
-inline sintl format_text_v(utf8 *buffer, uint size, const utf8 *format, vargs vargs)
+/* 
+	the slots are kept at most half full, so that probes stay short. the table is fixed, 16 MiB of slots
+	and 16 MiB of texts, which are zero pages until they're touched.
+*/
+constexpr uint symbols_capacity      = 1u << 20;
+constexpr uint symbol_slots_capacity = symbols_capacity * 2;
+
+/* 
+	a slot is zero while empty. otherwise its upper half is the upper half of its text's hash, and its lower
+	half is its symbol plus one, or pending while the symbol is being numbered, or full if it never will be.
+*/
+constexpr uintl symbol_slot_pending = uint32_maximum;
+constexpr uintl symbol_slot_full    = uint32_maximum - 1;
+
+typedef struct
 {
-	return __builtin_vsnprintf(buffer, size, format, vargs);
-}
+	const utf8 *runes;
+	uint        runes_count;
+} symbol_text;
 
-inline sintl format_text(utf8 *buffer, uint size, const utf8 *format, ...)
+static struct
 {
-	vargs vargs;
-	GET_VARGS(vargs, format);
-	sintl result = format_text_v(buffer, size, format, vargs);
-	END_VARGS(vargs);
-	return result;
+	_Atomic(uint) count;
+
+	_Atomic(uintl) slots[symbol_slots_capacity];
+	symbol_text    texts[symbols_capacity];
+} symbol_table;
+
+/* the texts are copied into memory of the thread that interns them, which is kept for the life of the process */
+static thread_local regional_allocator symbol_text_allocator;
+
+static uintl hash_symbol_text(const utf8 *text, uint size)
+{
+	/* a word at a time, each mixed in by a multiplication */
+	uintl hash = size * 0x9e3779b97f4a7c15ull;
+	for (; size >= 8; text += 8, size -= 8)
+	{
+		uintl word;
+		__builtin_memcpy(&word, text, 8);
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32;
+	}
+	if (size)
+	{
+		uintl word = 0;
+		__builtin_memcpy(&word, text, size);
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32;
+	}
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 29;
+	return hash;
 }
 
-inline void jump(landing landing, int status)
+/* only the thread that claimed the text's slot adds it, and the slot publishes it */
+static symbol add_symbol_text(const utf8 *text, uint size)
 {
-	longjmp(landing, status);
+	if (atomic_load_explicit(&symbol_table.count, memory_order_relaxed) >= symbols_capacity) return symbol_none;
+	symbol symbol = atomic_fetch_add_explicit(&symbol_table.count, 1, memory_order_relaxed);
+	if (symbol >= symbols_capacity) return symbol_none;
+
+	utf8 *runes = push_uninitialized(size, 1, &symbol_text_allocator);
+	copy(runes, text, size);
+	symbol_table.texts[symbol] = (symbol_text){ runes, size };
+	return symbol;
 }
 
-void _report(const char *file, uint line, severity severity, const char *message, ...)
+/* 
+	probes linearly, and claims an empty slot by swapping a pending one in, so that no two threads add
+	the same text. a thread that meets a pending slot of the same hash waits until it's numbered, which
+	is only as long as a copy of the text, as nothing is locked.
+*/
+symbol intern_symbol(const utf8 *text, uint size)
 {
-	/* printf("[%s] %s:%u: ", severity_representations[severity], file, line); */
-	printf("[%s] ", severity_representations[severity]);
+	uintl hash = hash_symbol_text(text, size);
+	uintl tag = hash & ~(uintl)uint32_maximum;
+	uint index = hash & (symbol_slots_capacity - 1);
+	for (uint probes_count = 0; probes_count < symbol_slots_capacity; ++probes_count, index = (index + 1) & (symbol_slots_capacity - 1))
+	{
+		_Atomic(uintl) *slot = &symbol_table.slots[index];
+		uintl value = atomic_load_explicit(slot, memory_order_acquire);
+		if (!value)
+		{
+			if (atomic_compare_exchange_strong_explicit(slot, &value, tag | symbol_slot_pending, memory_order_acquire, memory_order_acquire))
+			{
+				symbol symbol = add_symbol_text(text, size);
+				atomic_store_explicit(slot, tag | (symbol == symbol_none ? symbol_slot_full : (uintl)symbol + 1), memory_order_release);
+				return symbol;
+			}
+			/* another thread claimed it first, and `value` is what it swapped in */
+		}
+		if ((value & ~(uintl)uint32_maximum) != tag) continue;
 
-	vargs vargs;
-	GET_VARGS(vargs, message);
-	vprintf(message, vargs);
-	END_VARGS(vargs);
+		for (uint attempts_count = 0; (value & uint32_maximum) == symbol_slot_pending; ++attempts_count)
+		{
+			if (attempts_count < 64)
+			{
+#if defined(__SSE2__)
+				_mm_pause();
+#endif
+			}
+			else thrd_yield();
+			value = atomic_load_explicit(slot, memory_order_acquire);
+		}
+		if ((value & uint32_maximum) == symbol_slot_full) return symbol_none;
+
+		symbol symbol = (value & uint32_maximum) - 1;
+		const symbol_text *candidate = &symbol_table.texts[symbol];
+		if (candidate->runes_count == size && !__builtin_memcmp(candidate->runes, text, size)) return symbol;
+	}
+	return symbol_none;
 }
 
-inline void *allocate(uint size)
+const utf8 *get_symbol_text(symbol symbol, uint *size)
 {
-	void *memory = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-	ASSERT(memory);
-	return memory;
+	ASSERT(symbol < symbols_capacity);
+	*size = symbol_table.texts[symbol].runes_count;
+	return symbol_table.texts[symbol].runes;
 }
 
-inline void deallocate(void *memory, uint size)
+/* reals */
+
+/* the parameters of a binary interchange format */
+typedef struct
 {
-	OMIT(size);
-	VirtualFree(memory, 0, MEM_RELEASE);
+	uint mantissa_bits; /* the explicit ones */
+	sint minimum_exponent;
+	sint infinite_exponent;
+	sint smallest_power_of_ten; /* below which everything rounds to zero */
+	sint largest_power_of_ten;  /* above which everything rounds to infinity */
+	sint smallest_power_of_ten_rounded_to_even;
+	sint largest_power_of_ten_rounded_to_even;
+	sint largest_exact_power_of_ten;
+} real_format;
+
+static const real_format real64_format = { 52, -1023, 0x7FF, -342, 308, -4,  23, 22 };
+static const real_format real32_format = { 23, -127,  0xFF,  -64,  38,  -17, 10, 10 };
+
+/* the mantissa without its implicit bit, and the biased exponent */
+typedef struct
+{
+	uint64 mantissa;
+	sint   exponent;
+} real_bits;
+
+static const uint64 powers_of_five[][2] =
+{
+#define X(exponent, high, low) { high, low },
+	#include "code_powers_of_five.inc"
+#undef X
+};
+
+constexpr sint smallest_power_of_five = -342;
+
+static inline uint64 multiply_fully(uint64 left, uint64 right, uint64 *high)
+{
+	unsigned __int128 product = (unsigned __int128)left * right;
+	*high = (uint64)(product >> 64);
+	return (uint64)product;
 }
 
-void *push(uint size, uint alignment, regional_allocator *allocator)
+/* 
+	eisel-lemire: multiplies the significand by a 128 bit approximation of the power of ten,
+	which is always enough to tell how to round when the significand is exact.
+*/
+static real_bits compute_real_bits(sintl exponent, uint64 significand, const real_format *format)
 {
-	if (!allocator->active_region) allocator->active_region = allocator->first_region;
+	real_bits result = {0};
+	if (!significand || exponent < format->smallest_power_of_ten) return result;
+	if (exponent > format->largest_power_of_ten)
+	{
+		result.exponent = format->infinite_exponent;
+		return result;
+	}
 
-	uint forward_alignment;
-	bit  would_overflow = 1;
-	if (allocator->active_region)
+	uint leading_zeros_count = __builtin_clzll(significand);
+	significand <<= leading_zeros_count;
+
+	const uint64 *power = powers_of_five[exponent - smallest_power_of_five];
+	uint64 high;
+	uint64 low = multiply_fully(significand, power[0], &high);
+	uint64 precision_mask = UINT_MAXIMUM(uint64) >> (format->mantissa_bits + 3);
+	if ((high & precision_mask) == precision_mask)
+	{
+		/* the bits that decide the rounding may have been carried into, so account for the lower half too */
+		uint64 second_high;
+		multiply_fully(significand, power[1], &second_high);
+		low += second_high;
+		if (second_high > low) high += 1;
+	}
+
+	uint upper_bit = high >> 63;
+	uint shift = upper_bit + 64 - format->mantissa_bits - 3;
+	result.mantissa = high >> shift;
+	/* floor(log2(10^exponent)) + 63, through a fixed point approximation of log2(10) */
+	sint power_of_two = (sint)((((152170 + 65536) * exponent) >> 16) + 63);
+	result.exponent = power_of_two + upper_bit - leading_zeros_count - format->minimum_exponent;
+
+	if (result.exponent <= 0)
 	{
-		for (;;)
+		/* subnormal */
+		if (-result.exponent + 1 >= 64)
 		{
-			forward_alignment = get_forward_alignment((uintl)allocator->active_region->view + allocator->active_region->mass, alignment);
-			would_overflow = allocator->active_region->mass + forward_alignment + size > allocator->active_region->size;
-			if (!would_overflow) break;
-			if (!allocator->active_region->next) break;
-			allocator->active_region = allocator->active_region->next;
+			result.mantissa = 0;
+			result.exponent = 0;
+			return result;
 		}
+		result.mantissa >>= -result.exponent + 1;
+		result.mantissa += result.mantissa & 1;
+		result.mantissa >>= 1;
+		result.exponent = result.mantissa < (1ull << format->mantissa_bits) ? 0 : 1;
+		return result;
 	}
 
-	if (would_overflow)
+	/* a tie is only possible for small powers, where the product is exact; then round to even rather than up */
+	if (low <= 1 && exponent >= format->smallest_power_of_ten_rounded_to_even && exponent <= format->largest_power_of_ten_rounded_to_even && (result.mantissa & 3) == 1)
 	{
-		forward_alignment = 0;
-		if (!allocator->minimum_region_size) allocator->minimum_region_size = default_minimum_region_size_of_regional_allocator;
-		uint region_size = MAXIMUM(size, allocator->minimum_region_size);
-		uint allocation_size = sizeof(region) + region_size;
-		region *new_region = allocate(allocation_size);
-		new_region->prior = allocator->active_region;
-		if (allocator->active_region) allocator->active_region->next = new_region;
-		new_region->mass = 0;
-		new_region->size = region_size;
-		new_region->view = new_region->data;
-		new_region->next = 0;
-		allocator->active_region = new_region;
-		if (!allocator->first_region) allocator->first_region = allocator->active_region;
-	}
-
-	allocator->active_region->mass += forward_alignment;
-	void *memory = allocator->active_region->view + allocator->active_region->mass;
-	allocator->active_region->mass += size;
-	fill(memory, size, 0);
-	return memory;
+		if ((result.mantissa << shift) == high) result.mantissa &= ~1ull;
+	}
+	result.mantissa += result.mantissa & 1;
+	result.mantissa >>= 1;
+	if (result.mantissa >= (2ull << format->mantissa_bits))
+	{
+		result.mantissa = 1ull << format->mantissa_bits;
+		result.exponent += 1;
+	}
+	result.mantissa &= ~(1ull << format->mantissa_bits);
+	if (result.exponent >= format->infinite_exponent)
+	{
+		result.mantissa = 0;
+		result.exponent = format->infinite_exponent;
+	}
+	return result;
 }
 
-thread_local struct context context;
+/* 
+	the exact fallback, for when a significand had to be truncated and eisel-lemire can't tell the rounding:
+	holds all the digits, and shifts them by powers of two until the value is in [1/2, 1).
+*/
+constexpr uint maximum_big_decimal_digits_count = 768;
+constexpr sint big_decimal_point_range = 2047;
 
-struct base base;
+typedef struct
+{
+	uint  digits_count;
+	sint  point;        /* the value is 0.digits * 10^point */
+	bit   is_truncated; /* some nonzero digits did not fit */
+	uintb digits[maximum_big_decimal_digits_count + 19];
+} big_decimal;
 
-inline uintl get_time(void)
+static void trim_big_decimal(big_decimal *decimal)
 {
-	LARGE_INTEGER counter;
-	QueryPerformanceCounter(&counter);
-	return counter.QuadPart * 1e9 / win32.performance_frequency;
+	while (decimal->digits_count && !decimal->digits[decimal->digits_count - 1]) decimal->digits_count -= 1;
 }
 
-inline uint get_current_directory_path(utf8 *path)
+static void shift_big_decimal_right(big_decimal *decimal, uint shift)
 {
-	utf16 path_buffer[maximum_size_of_path];
-	uint size = GetCurrentDirectoryW(sizeof(path_buffer), path_buffer);
-	make_utf8_text_from_utf16(path, path_buffer);
-	return size;
+	uint read_index = 0;
+	uint write_index = 0;
+	uint64 n = 0;
+	while (!(n >> shift))
+	{
+		if (read_index < decimal->digits_count) n = 10 * n + decimal->digits[read_index++];
+		else if (!n) return;
+		else
+		{
+			while (!(n >> shift))
+			{
+				n = 10 * n;
+				read_index += 1;
+			}
+			break;
+		}
+	}
+
+	decimal->point -= (sint)read_index - 1;
+	if (decimal->point < -big_decimal_point_range)
+	{
+		decimal->digits_count = 0;
+		decimal->point = 0;
+		decimal->is_truncated = 0;
+		return;
+	}
+
+	uint64 mask = (1ull << shift) - 1;
+	while (read_index < decimal->digits_count)
+	{
+		uintb digit = (uintb)(n >> shift);
+		n = 10 * (n & mask) + decimal->digits[read_index++];
+		decimal->digits[write_index++] = digit;
+	}
+	while (n)
+	{
+		uintb digit = (uintb)(n >> shift);
+		n = 10 * (n & mask);
+		if (write_index < maximum_big_decimal_digits_count) decimal->digits[write_index++] = digit;
+		else if (digit) decimal->is_truncated = 1;
+	}
+	decimal->digits_count = write_index;
+	trim_big_decimal(decimal);
 }
 
-inline file_handle create_file(const utf8 *path)
+/* a shift of up to 60 adds up to 19 digits, so those are written past the end first, then moved into place */
+static void shift_big_decimal_left(big_decimal *decimal, uint shift)
 {
-	file_handle result = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, 0);
-	ASSERT(result != INVALID_HANDLE_VALUE);
-	return result;
+	constexpr uint headroom = 19;
+	if (!decimal->digits_count) return;
+
+	uint write_index = decimal->digits_count + headroom;
+	uint64 n = 0;
+	for (uint read_index = decimal->digits_count; read_index--;)
+	{
+		n += (uint64)decimal->digits[read_index] << shift;
+		uint64 quotient = n / 10;
+		decimal->digits[--write_index] = (uintb)(n - 10 * quotient);
+		n = quotient;
+	}
+	while (n)
+	{
+		uint64 quotient = n / 10;
+		decimal->digits[--write_index] = (uintb)(n - 10 * quotient);
+		n = quotient;
+	}
+
+	uint digits_count = decimal->digits_count + headroom - write_index;
+	decimal->point += (sint)(headroom - write_index);
+	MOVE(decimal->digits, decimal->digits + write_index, digits_count);
+	if (digits_count > maximum_big_decimal_digits_count)
+	{
+		for (uint i = maximum_big_decimal_digits_count; i < digits_count; ++i)
+		{
+			if (decimal->digits[i]) decimal->is_truncated = 1;
+		}
+		digits_count = maximum_big_decimal_digits_count;
+	}
+	decimal->digits_count = digits_count;
+	trim_big_decimal(decimal);
 }
 
-inline file_handle open_file(const utf8 *path)
+/* the integer part, rounded to the nearest and to even on ties */
+static uint64 round_big_decimal(const big_decimal *decimal)
 {
-	file_handle result = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-	ASSERT(result != INVALID_HANDLE_VALUE);
-	return result;
+	if (!decimal->digits_count || decimal->point < 0) return 0;
+	if (decimal->point > 18) return UINT_MAXIMUM(uint64);
+
+	uint point = (uint)decimal->point;
+	uint64 n = 0;
+	for (uint i = 0; i < point; ++i) n = 10 * n + (i < decimal->digits_count ? decimal->digits[i] : 0);
+
+	bit rounds_up = 0;
+	if (point < decimal->digits_count)
+	{
+		rounds_up = decimal->digits[point] >= 5;
+		if (decimal->digits[point] == 5 && point + 1 == decimal->digits_count)
+		{
+			rounds_up = decimal->is_truncated || (point > 0 && (decimal->digits[point - 1] & 1));
+		}
+	}
+	return n + rounds_up;
 }
 
-inline uintl get_size_of_file(file_handle handle)
+static real_bits compute_real_bits_exactly(big_decimal *decimal, const real_format *format)
 {
-	LARGE_INTEGER file_size;
-	ASSERT(GetFileSizeEx(handle, &file_size));
-	return file_size.QuadPart;
+	/* the shifts that move the point by one digit each, up to 60 */
+	const uintb shifts[] = { 0, 3, 6, 9, 13, 16, 19, 23, 26, 29, 33, 36, 39, 43, 46, 49, 53, 56, 59 };
+	constexpr uint maximum_shift = 60;
+
+	real_bits result = {0};
+	real_bits infinity = { 0, format->infinite_exponent };
+	if (!decimal->digits_count || decimal->point < -324) return result;
+	if (decimal->point >= 310) return infinity;
+
+	sint exponent = 0;
+	while (decimal->point > 0)
+	{
+		uint n = (uint)decimal->point;
+		uint shift = n < COUNT(shifts) ? shifts[n] : maximum_shift;
+		shift_big_decimal_right(decimal, shift);
+		if (decimal->point < -big_decimal_point_range) return result;
+		exponent += shift;
+	}
+	while (decimal->point <= 0)
+	{
+		uint shift;
+		if (!decimal->point)
+		{
+			if (decimal->digits[0] >= 5) break;
+			shift = decimal->digits[0] < 2 ? 2 : 1;
+		}
+		else
+		{
+			uint n = (uint)-decimal->point;
+			shift = n < COUNT(shifts) ? shifts[n] : maximum_shift;
+		}
+		shift_big_decimal_left(decimal, shift);
+		if (decimal->point > big_decimal_point_range) return infinity;
+		exponent -= shift;
+	}
+
+	/* from [1/2, 1) to [1, 2) */
+	exponent -= 1;
+	while (format->minimum_exponent + 1 > exponent)
+	{
+		uint n = (uint)(format->minimum_exponent + 1 - exponent);
+		if (n > maximum_shift) n = maximum_shift;
+		shift_big_decimal_right(decimal, n);
+		exponent += n;
+	}
+	if (exponent - format->minimum_exponent >= format->infinite_exponent) return infinity;
+
+	shift_big_decimal_left(decimal, format->mantissa_bits + 1);
+	uint64 mantissa = round_big_decimal(decimal);
+	if (mantissa >= (1ull << (format->mantissa_bits + 1)))
+	{
+		/* rounding carried into another bit */
+		shift_big_decimal_right(decimal, 1);
+		exponent += 1;
+		mantissa = round_big_decimal(decimal);
+		if (exponent - format->minimum_exponent >= format->infinite_exponent) return infinity;
+	}
+
+	result.exponent = exponent - format->minimum_exponent;
+	if (mantissa < (1ull << format->mantissa_bits)) result.exponent -= 1;
+	result.mantissa = mantissa & ((1ull << format->mantissa_bits) - 1);
+	return result;
 }
 
-inline uint read_from_file(void *buffer, uint size, file_handle handle)
+static void read_big_decimal(const utf8 *text, uint size, big_decimal *decimal)
 {
-	DWORD bytes_read_count;
-	ASSERT(ReadFile(handle, buffer, size, &bytes_read_count, 0));
-	return bytes_read_count;
+	decimal->digits_count = 0;
+	decimal->point = 0;
+	decimal->is_truncated = 0;
+
+	uint i = 0;
+	bit is_after_point = 0;
+	for (; i < size && (text[i] | 0x20) != 'e'; ++i)
+	{
+		utf8 character = text[i];
+		if (character == '_') continue;
+		if (character == '.')
+		{
+			is_after_point = 1;
+			continue;
+		}
+
+		uintb digit = character - '0';
+		if (!digit && !decimal->digits_count)
+		{
+			if (is_after_point) decimal->point -= 1;
+			continue;
+		}
+		if (decimal->digits_count < maximum_big_decimal_digits_count) decimal->digits[decimal->digits_count++] = digit;
+		else if (digit) decimal->is_truncated = 1;
+		if (!is_after_point) decimal->point += 1;
+	}
+
+	if (i < size)
+	{
+		i += 1;
+		bit is_negative = text[i] == '-';
+		if (text[i] == '-' || text[i] == '+') i += 1;
+		sint exponent = 0;
+		for (; i < size; ++i)
+		{
+			if (text[i] == '_') continue;
+			if (exponent < 100000) exponent = 10 * exponent + (text[i] - '0');
+		}
+		decimal->point += is_negative ? -exponent : exponent;
+	}
+	trim_big_decimal(decimal);
 }
 
-inline void close_file(file_handle handle)
+/* 19 digits always fit in 64 bits */
+constexpr uint maximum_significand_digits_count = 19;
+
+void decode_real_text(real64 *left64, real32 *left32, const utf8 *text, uint size)
 {
-	CloseHandle(handle);
-}
+	/* gather at most 19 significant digits, and the power of ten that goes with them */
+	uint64 significand = 0;
+	uint digits_count = 0;
+	sintl exponent = 0;
+	bit is_truncated = 0;
+	bit is_after_point = 0;
+	uint i = 0;
+	for (; i < size && (text[i] | 0x20) != 'e'; ++i)
+	{
+		utf8 character = text[i];
+		if (character == '_') continue;
+		if (character == '.')
+		{
+			is_after_point = 1;
+			continue;
+		}
+
+		uintb digit = character - '0';
+		if (!digit && !digits_count)
+		{
+			if (is_after_point) exponent -= 1;
+			continue;
+		}
+		if (digits_count < maximum_significand_digits_count)
+		{
+			significand = 10 * significand + digit;
+			digits_count += 1;
+			if (is_after_point) exponent -= 1;
+		}
+		else
+		{
+			if (digit) is_truncated = 1;
+			if (!is_after_point) exponent += 1;
+		}
+	}
+	if (i < size)
+	{
+		i += 1;
+		bit is_negative = text[i] == '-';
+		if (text[i] == '-' || text[i] == '+') i += 1;
+		sintl explicit_exponent = 0;
+		for (; i < size; ++i)
+		{
+			if (text[i] == '_') continue;
+			if (explicit_exponent < 100000) explicit_exponent = 10 * explicit_exponent + (text[i] - '0');
+		}
+		exponent += is_negative ? -explicit_exponent : explicit_exponent;
+	}
+
+	/* 
+		small enough integers times or over small enough powers of ten are exact,
+		so a single rounded operation gives the correctly rounded result
+	*/
+	const real64 exact_powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	bit is_exact64 = 0;
+	bit is_exact32 = 0;
+	if (!is_truncated && exponent >= -real64_format.largest_exact_power_of_ten && exponent <= real64_format.largest_exact_power_of_ten && significand <= (1ull << 53))
+	{
+		*left64 = exponent < 0 ? (real64)significand / exact_powers_of_ten[-exponent] : (real64)significand * exact_powers_of_ten[exponent];
+		is_exact64 = 1;
+	}
+	if (!is_truncated && exponent >= -real32_format.largest_exact_power_of_ten && exponent <= real32_format.largest_exact_power_of_ten && significand <= (1ull << 24))
+	{
+		*left32 = exponent < 0 ? (real32)significand / (real32)exact_powers_of_ten[-exponent] : (real32)significand * (real32)exact_powers_of_ten[exponent];
+		is_exact32 = 1;
+	}
+	if (is_exact64 && is_exact32) return;
+
+	/* a truncated significand is between itself and its successor, so if both round the same, so does it */
+	real_bits bits64 = compute_real_bits(exponent, significand, &real64_format);
+	real_bits bits32 = compute_real_bits(exponent, significand, &real32_format);
+	if (is_truncated)
+	{
+		real_bits upper_bits64 = compute_real_bits(exponent, significand + 1, &real64_format);
+		real_bits upper_bits32 = compute_real_bits(exponent, significand + 1, &real32_format);
+		bit is_ambiguous64 = !is_exact64 && (bits64.mantissa != upper_bits64.mantissa || bits64.exponent != upper_bits64.exponent);
+		bit is_ambiguous32 = !is_exact32 && (bits32.mantissa != upper_bits32.mantissa || bits32.exponent != upper_bits32.exponent);
+		if (is_ambiguous64 || is_ambiguous32)
+		{
+			big_decimal decimal;
+			if (is_ambiguous64)
+			{
+				read_big_decimal(text, size, &decimal);
+				bits64 = compute_real_bits_exactly(&decimal, &real64_format);
+			}
+			if (is_ambiguous32)
+			{
+				read_big_decimal(text, size, &decimal);
+				bits32 = compute_real_bits_exactly(&decimal, &real32_format);
+			}
+		}
+	}
+
+	if (!is_exact64)
+	{
+		uint64 bits = bits64.mantissa | ((uint64)bits64.exponent << real64_format.mantissa_bits);
+		copy(left64, &bits, sizeof(bits));
+	}
+	if (!is_exact32)
+	{
+		uint32 bits = (uint32)(bits32.mantissa | ((uint64)bits32.exponent << real32_format.mantissa_bits));
+		copy(left32, &bits, sizeof(bits));
+	}
+}
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include <stb/stb_sprintf.h>
+
+inline sintl format_text_v(utf8 *buffer, uint size, const utf8 *format, vargs vargs)
+{
+	return __builtin_vsnprintf(buffer, size, format, vargs);
+}
+
+inline sintl format_text(utf8 *buffer, uint size, const utf8 *format, ...)
+{
+	vargs vargs;
+	GET_VARGS(vargs, format);
+	sintl result = format_text_v(buffer, size, format, vargs);
+	END_VARGS(vargs);
+	return result;
+}
+
+inline void jump(landing landing, int status)
+{
+	longjmp(landing, status);
+}
+
+void _report(const char *file, uint line, severity severity, const char *message, ...)
+{
+	/* printf("[%s] %s:%u: ", severity_representations[severity], file, line); */
+	printf("[%s] ", severity_representations[severity]);
+
+	vargs vargs;
+	GET_VARGS(vargs, message);
+	vprintf(message, vargs);
+	END_VARGS(vargs);
+}
+
+static void commit_region(uint mass, region *region)
+{
+	/* at least double what's committed, so that growing takes few commitments */
+	uint committed_size = sizeof(*region) + region->size;
+	uint new_committed_size = align_forward(sizeof(*region) + mass, region->is_huge ? huge_memory_page_size : commitment_granularity_of_region);
+	new_committed_size = MAXIMUM(new_committed_size, committed_size * 2);
+	new_committed_size = MINIMUM(new_committed_size, sizeof(*region) + region->capacity);
+	commit((byte *)region + committed_size, new_committed_size - committed_size);
+	region->size = new_committed_size - sizeof(*region);
+}
+
+/* each class is a lock-free stack of regions, whose head's top 16 bits are a
+   tag that's bumped on every change to avoid ABA. pooled regions are never
+   given back to the system, so it's fine to peek at a region that's being
+   popped by another thread */
+static _Atomic(uintl) region_pool[2][pooled_region_classes_count]; /* by whether they're huge */
+
+/* the pointer is in the low 48 bits, and the tag above them */
+constexpr uintl region_pool_tag_mask = ~LMASK(48);
+constexpr uintl region_pool_tag_increment = BIT(49);
+
+static inline uint get_region_class(uint footprint)
+{
+	return sizeof(uintl) * byte_bits_count - clz(footprint - 1) - 12;
+}
+
+region *acquire_region(uint footprint, bit reserves, bit is_huge)
+{
+	footprint = MAXIMUM(footprint, memory_page_size);
+	is_huge = is_huge && footprint >= huge_memory_page_size;
+	atomic_fetch_add_explicit(&base.acquired_regions_count, 1, memory_order_relaxed);
+	uint class = get_region_class(footprint);
+	if (class < pooled_region_classes_count)
+	{
+		footprint = memory_page_size << class;
+
+		uintl head = atomic_load_explicit(&region_pool[is_huge][class], memory_order_acquire);
+		while (head & ~region_pool_tag_mask)
+		{
+			region *pooled_region = (region *)(head & ~region_pool_tag_mask);
+			uintl next = (address)pooled_region->next | ((head & region_pool_tag_mask) + region_pool_tag_increment);
+			if (atomic_compare_exchange_weak_explicit(&region_pool[is_huge][class], &head, next, memory_order_acquire, memory_order_acquire))
+			{
+				atomic_fetch_add_explicit(&base.recycled_regions_count, 1, memory_order_relaxed);
+				return pooled_region;
+			}
+		}
+	}
+
+	region *new_region;
+	if (reserves)
+	{
+		uint committed_size = is_huge ? huge_memory_page_size : memory_page_size;
+		new_region = is_huge ? reserve_huge(footprint) : reserve(footprint);
+		commit(new_region, committed_size);
+		new_region->size = committed_size - sizeof(region);
+	}
+	else
+	{
+		new_region = is_huge ? allocate_huge(footprint) : (allocate)(footprint);
+		new_region->size = footprint - sizeof(region);
+	}
+	new_region->is_huge  = is_huge;
+	new_region->capacity = footprint - sizeof(region);
+	new_region->mass     = 0;
+	new_region->peak     = 0;
+	return new_region;
+}
+
+void release_region(region *region)
+{
+	uint footprint = sizeof(*region) + region->capacity;
+	uint class = get_region_class(footprint);
+	if (class >= pooled_region_classes_count)
+	{
+		deallocate(region, footprint);
+		return;
+	}
+
+	region->peak = MAXIMUM(region->peak, region->mass);
+	region->mass = 0;
+
+	bit is_huge = region->is_huge;
+	uintl head = atomic_load_explicit(&region_pool[is_huge][class], memory_order_relaxed);
+	do region->next = (struct region *)(head & ~region_pool_tag_mask);
+	while (!atomic_compare_exchange_weak_explicit(&region_pool[is_huge][class], &head, (address)region | ((head & region_pool_tag_mask) + region_pool_tag_increment), memory_order_release, memory_order_relaxed));
+}
+
+void release_regions(regional_allocator *allocator)
+{
+	region *next_region;
+	for (region *region = allocator->first_region; region; region = next_region)
+	{
+		next_region = region->next;
+		release_region(region);
+	}
+	allocator->first_region  = 0;
+	allocator->active_region = 0;
+}
+
+static region *create_region(uint size, regional_allocator *allocator)
+{
+	uint footprint;
+	bit  reserves = allocator->reservation_size != 0;
+	if (reserves) footprint = MAXIMUM(allocator->reservation_size, sizeof(region) + size);
+	else
+	{
+		if (!allocator->minimum_region_size) allocator->minimum_region_size = default_minimum_region_size_of_regional_allocator;
+		footprint = sizeof(region) + MAXIMUM(size, allocator->minimum_region_size);
+	}
+
+	region *new_region = acquire_region(footprint, reserves, allocator->uses_huge_pages);
+	if (size > new_region->size) commit_region(size, new_region);
+	new_region->view = new_region->data;
+	new_region->next = 0;
+	return new_region;
+}
+
+/* the parentheses keep the profiling macros from expanding */
+void *(push_uninitialized)(uint size, uint alignment, regional_allocator *allocator)
+{
+	region *active_region = allocator->active_region;
+	uint forward_alignment;
+	if (active_region)
+	{
+		/* bump within the active region, committing more of it if need be */
+		forward_alignment = get_forward_alignment((address)active_region->view + active_region->mass, alignment);
+		uint mass = active_region->mass + forward_alignment + size;
+		if (LIKELY(mass <= active_region->size)) goto bump;
+		if (mass <= active_region->capacity)
+		{
+			commit_region(mass, active_region);
+			goto bump;
+		}
+	}
+	else active_region = allocator->first_region;
+
+	/* look for a following region that's got room (they're left over from
+	   rewinding), or create one */
+	for (; active_region; active_region = active_region->next)
+	{
+		forward_alignment = get_forward_alignment((address)active_region->view + active_region->mass, alignment);
+		uint mass = active_region->mass + forward_alignment + size;
+		if (mass <= active_region->capacity)
+		{
+			if (mass > active_region->size) commit_region(mass, active_region);
+			allocator->active_region = active_region;
+			goto bump;
+		}
+		if (!active_region->next) break;
+	}
+
+	uint required_size = size + (alignment > universal_alignment ? alignment : 0);
+	region *new_region = create_region(required_size, allocator);
+	new_region->prior = active_region;
+	if (active_region) active_region->next = new_region;
+	else allocator->first_region = new_region;
+	allocator->active_region = active_region = new_region;
+	forward_alignment = get_forward_alignment((address)active_region->view, alignment);
+
+bump:
+	active_region->mass += forward_alignment;
+	void *memory = active_region->view + active_region->mass;
+	active_region->mass += size;
+	return memory;
+}
+
+void *(push)(uint size, uint alignment, regional_allocator *allocator)
+{
+	byte *memory = (push_uninitialized)(size, alignment, allocator);
+
+	/* only what was pushed before rewinding is dirty; the rest is zero as it
+	   came from the system */
+	region *region = allocator->active_region;
+	uint offset = memory - region->view;
+	if (offset < region->peak) fill(memory, MINIMUM(size, region->peak - offset), 0);
+	return memory;
+}
+
+bit (extend)(void *memory, uint size, uint additional_size, regional_allocator *allocator)
+{
+	region *region = allocator->active_region;
+	if (!region || (byte *)memory + size != region->view + region->mass) return 0;
+
+	uint mass = region->mass + additional_size;
+	if (mass > region->capacity) return 0;
+	if (mass > region->size) commit_region(mass, region);
+	region->mass = mass;
+	return 1;
+}
+
+temporary begin_temporary(regional_allocator *allocator)
+{
+	temporary temporary;
+	temporary.allocator = allocator;
+	temporary.region    = allocator->active_region;
+	temporary.mass      = temporary.region ? temporary.region->mass : 0;
+	return temporary;
+}
+
+void end_temporary(temporary temporary)
+{
+	regional_allocator *allocator = temporary.allocator;
+	region *region = temporary.region ? temporary.region : allocator->first_region;
+	if (!region) return;
+
+	/* empty the following regions, so that they're reused */
+	for (struct region *following = region->next; following; following = following->next)
+	{
+		following->peak = MAXIMUM(following->peak, following->mass);
+		following->mass = 0;
+	}
+	region->peak = MAXIMUM(region->peak, region->mass);
+	region->mass = temporary.region ? temporary.mass : 0;
+	allocator->active_region = region;
+}
+
+regional_allocator *get_scratch_allocator(const regional_allocator *conflict)
+{
+	regional_allocator *allocator = &context.allocators[0];
+	if (allocator == conflict) allocator = &context.allocators[1];
+	if (!allocator->first_region) allocator->reservation_size = default_reservation_size_of_regional_allocator;
+	return allocator;
+}
+
+thread_local struct context context;
+
+struct base base;
+
+/* tracing */
+
+typedef struct trace_event trace_event;
+struct trace_event
+{
+	const utf8  *name;
+	const utf8  *file;
+	sint         index;
+	bit          is_ending;
+	uintl        time;
+	trace_event *enclosing_event; /* of a beginning, the one it's nested in */
+};
+
+struct trace_buffer
+{
+	regional_allocator allocator; /* only holds events, so they're packed */
+	uint               thread_identifier;
+	trace_buffer      *next;
+
+	/* the beginnings that haven't ended, so that they can be ended when a failure jumps past their ends */
+	trace_event *innermost_event;
+	uint         depth;
+};
+
+static _Atomic(trace_buffer *) trace_buffers;
+
+static struct
+{
+	file_handle file;
+	uint        size;
+	utf8        buffer[KIB(64)];
+} trace_writer;
+
+static void write_trace_bytes(const utf8 *bytes, uint size)
+{
+	if (trace_writer.size + size > sizeof(trace_writer.buffer))
+	{
+		write_to_file(trace_writer.buffer, trace_writer.size, trace_writer.file);
+		trace_writer.size = 0;
+	}
+	copy(trace_writer.buffer + trace_writer.size, bytes, size);
+	trace_writer.size += size;
+}
+
+static void write_trace_text(const utf8 *text)
+{
+	/* escape what JSON wants escaped, which includes windows' path separators and control characters */
+	static const utf8 digits[] = "0123456789abcdef";
+	for (; *text; ++text)
+	{
+		uint8 character = (uint8)*text;
+		if (character < 0x20)
+		{
+			utf8 escape[] = { '\\', 'u', '0', '0', digits[character >> 4], digits[character & 0xF] };
+			write_trace_bytes(escape, sizeof(escape));
+			continue;
+		}
+		if (character == '"' || character == '\\') write_trace_bytes("\\", 1);
+		write_trace_bytes(text, 1);
+	}
+}
+
+static void write_trace(void)
+{
+	trace_writer.file = create_file(base.trace_path);
+	trace_writer.size = 0;
+
+	const utf8 beginning[] = "{\"traceEvents\":[\n";
+	write_trace_bytes(beginning, sizeof(beginning) - 1);
+
+	bit is_first = 1;
+	for (trace_buffer *buffer = atomic_load_explicit(&trace_buffers, memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		for (region *region = buffer->allocator.first_region; region; region = region->next)
+		{
+			uint offset = region == buffer->allocator.first_region ? align_forward(sizeof(trace_buffer), alignof(trace_event)) : 0;
+			for (; offset + sizeof(trace_event) <= region->mass; offset += sizeof(trace_event))
+			{
+				trace_event *event = (trace_event *)(region->view + offset);
+				utf8 text[128];
+				uint size = format_text(text, sizeof(text), "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":\"",
+					is_first ? "" : ",\n", event->is_ending ? 'E' : 'B', buffer->thread_identifier, event->time / 1e3);
+				write_trace_bytes(text, size);
+				write_trace_text(event->name);
+				const utf8 arguments[] = "\",\"args\":{\"file\":\"";
+				write_trace_bytes(arguments, sizeof(arguments) - 1);
+				write_trace_text(event->file ? event->file : "");
+				size = format_text(text, sizeof(text), "\",\"index\":%d}}", event->index);
+				write_trace_bytes(text, size);
+				is_first = 0;
+			}
+		}
+	}
+
+	const utf8 ending[] = "\n]}\n";
+	write_trace_bytes(ending, sizeof(ending) - 1);
+	write_to_file(trace_writer.buffer, trace_writer.size, trace_writer.file);
+	close_file(trace_writer.file);
+}
+
+void start_tracing(const utf8 *path)
+{
+	base.trace_path = path;
+	atexit(write_trace);
+}
+
+void _trace(const utf8 *name, const utf8 *file, sint index, bit is_ending)
+{
+	trace_buffer *buffer = context.trace_buffer;
+	if (UNLIKELY(!buffer))
+	{
+		/* the buffer goes first in its own allocator, as it outlives the thread */
+		regional_allocator allocator = { .reservation_size = default_reservation_size_of_regional_allocator };
+		buffer = PUSH(trace_buffer, 1, &allocator);
+		buffer->allocator = allocator;
+		buffer->thread_identifier = get_thread_identifier();
+
+		trace_buffer *head = atomic_load_explicit(&trace_buffers, memory_order_relaxed);
+		do buffer->next = head;
+		while (!atomic_compare_exchange_weak_explicit(&trace_buffers, &head, buffer, memory_order_release, memory_order_relaxed));
+		context.trace_buffer = buffer;
+	}
+
+	trace_event *event = PUSH_UNINITIALIZED(trace_event, 1, &buffer->allocator);
+	event->name      = name;
+	event->file      = file;
+	event->index     = index;
+	event->is_ending = is_ending;
+	event->time      = get_time();
+
+	if (!is_ending)
+	{
+		event->enclosing_event  = buffer->innermost_event;
+		buffer->innermost_event = event;
+		buffer->depth += 1;
+	}
+	else if (buffer->innermost_event)
+	{
+		buffer->innermost_event = buffer->innermost_event->enclosing_event;
+		buffer->depth -= 1;
+	}
+}
+
+uint _get_trace_depth(void)
+{
+	return context.trace_buffer ? context.trace_buffer->depth : 0;
+}
+
+void _unwind_trace(uint depth)
+{
+	trace_buffer *buffer = context.trace_buffer;
+	while (buffer && buffer->depth > depth)
+	{
+		const trace_event *event = buffer->innermost_event;
+		_trace(event->name, event->file, event->index, 1);
+	}
+}
+
+/* profiling */
+
+#if defined(CODE_PROFILING_ALLOCATIONS)
+
+typedef struct
+{
+	const char         *file;
+	uint                line;
+	regional_allocator *allocator; /* zero for allocations straight from the system */
+	bit                 is_occupied;
+
+	uintl bytes_count;
+	uintl allocations_count;
+	uintl wasted_bytes_count; /* by aligning */
+} allocation_profile;
+
+constexpr uint allocation_profiles_capacity = 4096;
+
+static struct
+{
+	atomic_flag lock;
+	bit         is_reporting_at_exit;
+
+	/* call sites and allocators are hashed into separate tables */
+	allocation_profile sites     [allocation_profiles_capacity];
+	allocation_profile allocators[allocation_profiles_capacity];
+} allocation_profiler = { ATOMIC_FLAG_INIT };
+
+static sint compare_allocation_profiles(const void *left, const void *right)
+{
+	const allocation_profile *left_profile = left, *right_profile = right;
+	if (left_profile->bytes_count != right_profile->bytes_count) return left_profile->bytes_count < right_profile->bytes_count ? 1 : -1;
+	return 0;
+}
+
+static void report_allocation_profiles(void)
+{
+	static allocation_profile profiles[allocation_profiles_capacity];
+
+	for (uint table = 0; table < 2; ++table)
+	{
+		allocation_profile *source = table ? allocation_profiler.allocators : allocation_profiler.sites;
+		uint profiles_count = 0;
+		for (uint i = 0; i < allocation_profiles_capacity; ++i)
+		{
+			if (source[i].allocations_count || source[i].bytes_count) profiles[profiles_count++] = source[i];
+		}
+		qsort(profiles, profiles_count, sizeof(*profiles), compare_allocation_profiles);
+
+		fprintf(stderr, "[%s] Allocations by %s:\n", severity_representations[severity_comment], table ? "allocator" : "call site");
+		fprintf(stderr, "\t%14s %10s %10s  %s\n", "bytes", "count", "waste", table ? "allocator" : "site");
+		for (uint i = 0; i < profiles_count; ++i)
+		{
+			allocation_profile *profile = &profiles[i];
+			fprintf(stderr, "\t%14llu %10llu %10llu  ", (unsigned long long)profile->bytes_count, (unsigned long long)profile->allocations_count, (unsigned long long)profile->wasted_bytes_count);
+			if (table && !profile->allocator) fprintf(stderr, "system\n");
+			else if (table) fprintf(stderr, "%p\n", (void *)profile->allocator);
+			else       fprintf(stderr, "%s:%u\n", profile->file, profile->line);
+		}
+	}
+}
+
+static void profile_allocation(const char *file, uint line, regional_allocator *allocator, uint size, uint wasted_size, bit is_new)
+{
+	while (atomic_flag_test_and_set_explicit(&allocation_profiler.lock, memory_order_acquire));
+
+	if (!allocation_profiler.is_reporting_at_exit)
+	{
+		allocation_profiler.is_reporting_at_exit = 1;
+		atexit(report_allocation_profiles);
+	}
+
+	/* both tables are probed linearly, and a full table drops the record */
+	allocation_profile *profile = 0;
+	address hash = ((address)file * 31 + line) * 0x9e3779b97f4a7c15ull;
+	for (uint i = 0; i < allocation_profiles_capacity; ++i)
+	{
+		allocation_profile *candidate = &allocation_profiler.sites[(hash + i) % allocation_profiles_capacity];
+		if (!candidate->is_occupied) { candidate->is_occupied = 1; candidate->file = file; candidate->line = line; }
+		if (candidate->file == file && candidate->line == line) { profile = candidate; break; }
+	}
+	if (profile)
+	{
+		profile->bytes_count        += size;
+		profile->allocations_count  += is_new;
+		profile->wasted_bytes_count += wasted_size;
+	}
+
+	profile = 0;
+	hash = (address)allocator * 0x9e3779b97f4a7c15ull;
+	for (uint i = 0; i < allocation_profiles_capacity; ++i)
+	{
+		allocation_profile *candidate = &allocation_profiler.allocators[(hash + i) % allocation_profiles_capacity];
+		if (!candidate->is_occupied) { candidate->is_occupied = 1; candidate->allocator = allocator; }
+		if (candidate->allocator == allocator) { profile = candidate; break; }
+	}
+	if (profile)
+	{
+		profile->bytes_count        += size;
+		profile->allocations_count  += is_new;
+		profile->wasted_bytes_count += wasted_size;
+	}
+
+	atomic_flag_clear_explicit(&allocation_profiler.lock, memory_order_release);
+}
+
+static uint get_wasted_size(const byte *memory, const region *prior_region, uint prior_mass, const regional_allocator *allocator)
+{
+	const region *region = allocator->active_region;
+	return memory - (region->view + (region == prior_region ? prior_mass : 0));
+}
+
+void *_profile_push(const char *file, uint line, uint size, uint alignment, regional_allocator *allocator)
+{
+	region *prior_region = allocator->active_region;
+	uint prior_mass = prior_region ? prior_region->mass : 0;
+	byte *memory = (push)(size, alignment, allocator);
+	profile_allocation(file, line, allocator, size, get_wasted_size(memory, prior_region, prior_mass, allocator), 1);
+	return memory;
+}
+
+void *_profile_push_uninitialized(const char *file, uint line, uint size, uint alignment, regional_allocator *allocator)
+{
+	region *prior_region = allocator->active_region;
+	uint prior_mass = prior_region ? prior_region->mass : 0;
+	byte *memory = (push_uninitialized)(size, alignment, allocator);
+	profile_allocation(file, line, allocator, size, get_wasted_size(memory, prior_region, prior_mass, allocator), 1);
+	return memory;
+}
+
+bit _profile_extend(const char *file, uint line, void *memory, uint size, uint additional_size, regional_allocator *allocator)
+{
+	bit extended = (extend)(memory, size, additional_size, allocator);
+	if (extended) profile_allocation(file, line, allocator, additional_size, 0, 0);
+	return extended;
+}
+
+void *_profile_allocate(const char *file, uint line, uint size)
+{
+	void *memory = (allocate)(size);
+	profile_allocation(file, line, 0, size, 0, 1);
+	return memory;
+}
+
+#endif
+
+/* platform */
+
+#if defined(CODE_ON_PLATFORM_WIN32)
+
+inline void *(allocate)(uint size)
+{
+	void *memory = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	ASSERT(memory);
+	return memory;
+}
+
+inline void deallocate(void *memory, uint size)
+{
+	OMIT(size);
+	VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+inline void *reserve(uint size)
+{
+	void *memory = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+	ASSERT(memory);
+	return memory;
+}
+
+inline void commit(void *memory, uint size)
+{
+	void *result = VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE);
+	ASSERT(result);
+}
+
+inline void *allocate_huge(uint size)
+{
+	/* large pages need the "lock pages in memory" privilege */
+	SIZE_T large_page_size = GetLargePageMinimum();
+	if (large_page_size && !(size % large_page_size))
+	{
+		void *memory = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory) return memory;
+	}
+	return (allocate)(size);
+}
+
+inline void *reserve_huge(uint size)
+{
+	/* large pages can't be committed piecemeal */
+	return reserve(size);
+}
+
+inline uintl get_time(void)
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart * 1e9 / win32.performance_frequency;
+}
+
+inline uint get_thread_identifier(void)
+{
+	return GetCurrentThreadId();
+}
+
+inline uint get_current_directory_path(utf8 *path)
+{
+	utf16 path_buffer[maximum_size_of_path];
+	uint size = GetCurrentDirectoryW(sizeof(path_buffer), path_buffer);
+	make_utf8_text_from_utf16(path, path_buffer);
+	return size;
+}
+
+inline file_handle create_file(const utf8 *path)
+{
+	file_handle result = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	ASSERT(result != INVALID_HANDLE_VALUE);
+	return result;
+}
+
+inline file_handle open_file(const utf8 *path)
+{
+	file_handle result = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	ASSERT(result != INVALID_HANDLE_VALUE);
+	return result;
+}
+
+inline uintl get_size_of_file(file_handle handle)
+{
+	LARGE_INTEGER file_size;
+	ASSERT(GetFileSizeEx(handle, &file_size));
+	return file_size.QuadPart;
+}
+
+inline uint read_from_file(void *buffer, uint size, file_handle handle)
+{
+	DWORD bytes_read_count;
+	ASSERT(ReadFile(handle, buffer, size, &bytes_read_count, 0));
+	return bytes_read_count;
+}
+
+inline uint write_to_file(const void *buffer, uint size, file_handle handle)
+{
+	DWORD bytes_written_count;
+	BOOL result = WriteFile(handle, buffer, size, &bytes_written_count, 0);
+	ASSERT(result);
+	return bytes_written_count;
+}
+
+inline const utf8 *map_file(file_handle handle, uint size)
+{
+	/* a view can't be followed by a page of our own, so the ETX has to fit in
+	   the view's last page */
+	if (!size || !get_backward_alignment(size, memory_page_size)) return 0;
+
+	HANDLE mapping = CreateFileMappingW(handle, 0, PAGE_WRITECOPY, 0, 0, 0);
+	if (!mapping) return 0;
+	utf8 *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) return 0;
+
+	view[size] = '\3'; /* only copies the last page */
+	DWORD protection;
+	VirtualProtect(view, size + 1, PAGE_READONLY, &protection);
+	return view;
+}
+
+inline void unmap_file(const utf8 *view, uint size)
+{
+	OMIT(size);
+	UnmapViewOfFile(view);
+}
+
+inline void close_file(file_handle handle)
+{
+	CloseHandle(handle);
+}
+
+#elif defined(CODE_ON_PLATFORM_LINUX)
+
+inline void *(allocate)(uint size)
+{
+	void *memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	ASSERT(memory != MAP_FAILED);
+	return memory;
+}
+
+inline void deallocate(void *memory, uint size)
+{
+	munmap(memory, size);
+}
+
+inline void *reserve(uint size)
+{
+	void *memory = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	ASSERT(memory != MAP_FAILED);
+	return memory;
+}
+
+inline void commit(void *memory, uint size)
+{
+	sint result = mprotect(memory, size, PROT_READ | PROT_WRITE);
+	ASSERT(!result);
+}
+
+inline void *allocate_huge(uint size)
+{
+	/* explicit huge pages are taken from the pool up front, so this fails
+	   early instead of faulting later on */
+	void *memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory != MAP_FAILED) return memory;
+
+	memory = reserve_huge(size);
+	commit(memory, size);
+	return memory;
+}
+
+inline void *reserve_huge(uint size)
+{
+	/* reserve an extra huge page, so the reservation can be aligned to one for
+	   transparent huge pages */
+	uintl padded_size = (uintl)size + huge_memory_page_size;
+	byte *memory = mmap(0, padded_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	ASSERT(memory != MAP_FAILED);
+	byte *aligned_memory = (byte *)align_forward((address)memory, huge_memory_page_size);
+	if (aligned_memory != memory) munmap(memory, aligned_memory - memory);
+	munmap(aligned_memory + size, memory + padded_size - (aligned_memory + size));
+	madvise(aligned_memory, size, MADV_HUGEPAGE);
+	return aligned_memory;
+}
+
+inline uintl get_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+	return (uintl)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+inline uint get_thread_identifier(void)
+{
+	return gettid();
+}
+
+inline uint get_current_directory_path(utf8 *path)
+{
+	utf8 *result = getcwd(path, maximum_size_of_path);
+	ASSERT(result);
+	return get_size_of_utf8_text(path);
+}
+
+inline file_handle create_file(const utf8 *path)
+{
+	file_handle result = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ASSERT(result >= 0);
+	return result;
+}
+
+inline file_handle open_file(const utf8 *path)
+{
+	file_handle result = open(path, O_RDONLY);
+	ASSERT(result >= 0);
+	return result;
+}
+
+inline uintl get_size_of_file(file_handle handle)
+{
+	struct stat status;
+	sint result = fstat(handle, &status);
+	ASSERT(!result);
+	return status.st_size;
+}
+
+inline uint read_from_file(void *buffer, uint size, file_handle handle)
+{
+	/* `pread` may return less than what was asked for, so keep on reading */
+	uint bytes_read_count = 0;
+	while (bytes_read_count < size)
+	{
+		ssize_t result = pread(handle, (byte *)buffer + bytes_read_count, size - bytes_read_count, bytes_read_count);
+		ASSERT(result >= 0);
+		if (!result) break;
+		bytes_read_count += result;
+	}
+	return bytes_read_count;
+}
+
+inline uint write_to_file(const void *buffer, uint size, file_handle handle)
+{
+	uint bytes_written_count = 0;
+	while (bytes_written_count < size)
+	{
+		ssize_t result = write(handle, (const byte *)buffer + bytes_written_count, size - bytes_written_count);
+		ASSERT(result > 0);
+		bytes_written_count += result;
+	}
+	return bytes_written_count;
+}
+
+inline const utf8 *map_file(file_handle handle, uint size)
+{
+	if (!size) return 0;
+
+	/* reserve a page beyond the contents, so there's always room for the ETX */
+	uintl view_size = align_forward(size, memory_page_size) + memory_page_size;
+	byte *view = mmap(0, view_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (view == MAP_FAILED) return 0;
+	if (mmap(view, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, handle, 0) == MAP_FAILED
+	 || mmap(view + view_size - memory_page_size, memory_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+	{
+		munmap(view, view_size);
+		return 0;
+	}
+
+	view[size] = '\3'; /* only copies the page that it's on */
+	mprotect(view, view_size, PROT_READ);
+	madvise(view, size, MADV_SEQUENTIAL);
+	return (const utf8 *)view;
+}
+
+inline void unmap_file(const utf8 *view, uint size)
+{
+	munmap((void *)view, align_forward(size, memory_page_size) + memory_page_size);
+}
+
+inline void close_file(file_handle handle)
+{
+	close(handle);
+}
+
+#endif
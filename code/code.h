@@ -11,20 +11,36 @@
 	#define CODE_ON_PLATFORM_LINUX
 #endif
 
-#define UNICODE
-#define _UNICODE
-#include <Windows.h>
+#if defined(CODE_ON_PLATFORM_WIN32)
+	#define UNICODE
+	#define _UNICODE
+	#include <Windows.h>
+#elif defined(CODE_ON_PLATFORM_LINUX)
+	#define _GNU_SOURCE
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <time.h>
+#endif
 
 #include <assert.h>
 #include <locale.h>
 #include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <threads.h>
 #include <wchar.h>
 #include <stddef.h>
 #include <setjmp.h>
 
+#if defined(__SSE2__)
+	#include <immintrin.h>
+#endif
+
 #define UNREACHABLE() __builtin_unreachable()
 
 #define EXPECT(x, v)  __builtin_expect((x), (v))
@@ -63,7 +79,11 @@ typedef float  real32;
 typedef double real64;
 
 typedef char    utf8;
+#if defined(CODE_ON_PLATFORM_WIN32)
 typedef wchar_t utf16;
+#else
+typedef uint16  utf16;
+#endif
 typedef uint32  utf32;
 
 #define UINT_MAXIMUM(type) ((type)~0)
@@ -147,7 +167,7 @@ constexpr bits64 bit30 = BIT(30);
 constexpr bits64 bit31 = BIT(31);
 constexpr bits64 bit32 = BIT(32);
 
-#define LMASK(x) (BIT(x) - 1)
+#define LMASK(x) (BIT((x) + 1) - 1)
 
 constexpr bits64 lmask1  = LMASK(1);
 constexpr bits64 lmask2  = LMASK(2);
@@ -182,11 +202,11 @@ constexpr bits64 lmask30 = LMASK(30);
 constexpr bits64 lmask31 = LMASK(31);
 constexpr bits64 lmask32 = LMASK(32);
 
-address get_backward_alignment(address address, uintb alignment);
-address get_forward_alignment (address address, uintb alignment);
+address get_backward_alignment(address address, uint alignment);
+address get_forward_alignment (address address, uint alignment);
 
-address align_forward (address address, uintb alignment);
-address align_backward(address address, uintb alignment);
+address align_forward (address address, uint alignment);
+address align_backward(address address, uint alignment);
 
 #define MINIMUM(a, b) ((a) < (b) ? (a) : (b))
 #define MAXIMUM(a, b) ((a) > (b) ? (a) : (b))
@@ -196,12 +216,50 @@ void move(void *left, const void *right, uint size);
 void fill(void *left, uint size, byte value);
 void zero(void *left, uint size);
 
-#define COPY(left, right, count) copy(left, right, (count) * sizeof(typeof(*right)))
-#define MOVE(left, right, count) move(left, right, (count) * sizeof(typeof(*right)))
-#define FILL(left, count, value) fill(left, (count) * sizeof(typeof(*left)), value)
-#define ZERO(left, count)        zero(left, (count) * sizeof(typeof(*left)))
+#define COPY(left, right, count) copy(left, right, (count) * sizeof(typeof(*(right))))
+#define MOVE(left, right, count) move(left, right, (count) * sizeof(typeof(*(right))))
+#define FILL(left, count, value) fill(left, (count) * sizeof(typeof(*(left))), value)
+#define ZERO(left, count)        zero(left, (count) * sizeof(typeof(*(left))))
+
+/* the widest byte vectors the target has, for scanning text in bulk */
+#if defined(__AVX2__)
+	typedef __m256i vector;
+
+	#define VECTOR_SIZE 32
+
+	#define VECTOR_LOAD(x)       _mm256_loadu_si256((const __m256i *)(x))
+	#define VECTOR_SPLAT(x)      _mm256_set1_epi8((char)(x))
+	#define VECTOR_EQUAL(a, b)   _mm256_cmpeq_epi8(a, b)
+	#define VECTOR_GREATER(a, b) _mm256_cmpgt_epi8(a, b)
+	#define VECTOR_ADD(a, b)     _mm256_add_epi8(a, b)
+	#define VECTOR_AND(a, b)     _mm256_and_si256(a, b)
+	#define VECTOR_OR(a, b)      _mm256_or_si256(a, b)
+	#define VECTOR_MASK(x)       (uint)(uint32)_mm256_movemask_epi8(x)
+#elif defined(__SSE2__)
+	typedef __m128i vector;
+
+	#define VECTOR_SIZE 16
+
+	#define VECTOR_LOAD(x)       _mm_loadu_si128((const __m128i *)(x))
+	#define VECTOR_SPLAT(x)      _mm_set1_epi8((char)(x))
+	#define VECTOR_EQUAL(a, b)   _mm_cmpeq_epi8(a, b)
+	#define VECTOR_GREATER(a, b) _mm_cmpgt_epi8(a, b)
+	#define VECTOR_ADD(a, b)     _mm_add_epi8(a, b)
+	#define VECTOR_AND(a, b)     _mm_and_si128(a, b)
+	#define VECTOR_OR(a, b)      _mm_or_si128(a, b)
+	#define VECTOR_MASK(x)       (uint)_mm_movemask_epi8(x)
+#endif
+
+#if defined(VECTOR_SIZE)
+	#define VECTOR_FULL_MASK (uint)((1ull << VECTOR_SIZE) - 1)
+
+	/* bytes in [minimum, maximum], by moving the range to the bottom of the signed bytes */
+	#define VECTOR_IN_RANGE(x, minimum, maximum) \
+		VECTOR_GREATER(VECTOR_SPLAT(-128 + ((maximum) - (minimum)) + 1), VECTOR_ADD(x, VECTOR_SPLAT(128 - (minimum))))
+#endif
 
 sintb decode_utf8 (utf32 *left, const utf8  *right);
+uintb decode_valid_utf8(utf32 *left, const utf8 *right);
 sintb decode_utf16(utf32 *left, const utf16 *right);
 
 sintb encode_utf8 (utf8  *left, utf32 right);
@@ -210,6 +268,9 @@ sintb encode_utf16(utf16 *left, utf32 right);
 sintl make_utf8_text_from_utf16(utf8  *left, const utf16 *right);
 sintl make_utf16_text_from_utf8(utf16 *left, const utf8  *right);
 
+/* returns the offset of the first malformed sequence, or the size if there is none */
+uint validate_utf8(const utf8 *text, uint size);
+
 uint get_size_of_utf8_text (const utf8  *text);
 uint get_size_of_utf16_text(const utf16 *text);
 
@@ -224,6 +285,12 @@ void copy_sized_text(utf8 *left, const utf8 *right, uint size);
 
 #define COPY_LITERAL_TEXT(left, right) copy_sized_text(left, right, sizeof(right))
 
+/* 
+	reads digits, then optionally a full stop and more digits, then optionally an exponent,
+	with `_`s between. both results are rounded to the nearest, and to even on ties.
+*/
+void decode_real_text(real64 *left64, real32 *left32, const utf8 *text, uint size);
+
 sintl format_text_v(utf8 *buffer, uint size, const utf8 *format, vargs vargs);
 sintl format_text  (utf8 *buffer, uint size, const utf8 *format, ...);
 
@@ -260,6 +327,7 @@ void _report(const char *file, uint line, severity severity, const char *message
 #define REPORT_FAILURE(...) REPORT(severity_failure, __VA_ARGS__)
 
 constexpr uint memory_page_size = 4096;
+constexpr uint huge_memory_page_size = MIB(2);
 constexpr uint universal_alignment = alignof(max_align_t);
 
 void *allocate(uint size);
@@ -270,11 +338,24 @@ void deallocate(void *memory, uint size);
 
 #define DEALLOCATE(memory, count) deallocate(memory, (count) * sizeof(typeof(*memory)))
 
+/* reserved memory is inaccessible until it's committed, and it's released by
+   `deallocate` */
+void *reserve(uint size);
+void  commit (void *memory, uint size);
+
+/* these try to back the memory with huge pages, and fall back to normal
+   pages */
+void *allocate_huge(uint size);
+void *reserve_huge (uint size);
+
 typedef struct region region;
 struct region
 {
 	uint    size;
 	uint    mass;
+	uint    capacity; /* `size` can be committed up to this */
+	uint    peak;     /* the mass that was reached before rewinding; beyond this is zero */
+	bit     is_huge;
 	byte   *view;
 	region *prior;
 	region *next;
@@ -283,26 +364,80 @@ struct region
 };
 
 constexpr uint default_minimum_region_size_of_regional_allocator = memory_page_size - sizeof(region);
+constexpr uint default_reservation_size_of_regional_allocator     = GIG(1);
+constexpr uint commitment_granularity_of_region                   = KIB(64);
+
+constexpr uint pooled_region_classes_count = 20; /* footprints from 4 KiB to 2 GiB */
 
 typedef struct regional_allocator regional_allocator;
 struct regional_allocator
 {
 	//allocator *allocator;
 	uint       minimum_region_size;
+	uint       reservation_size; /* if nonzero, regions are reserved with this size and committed as they grow */
+	bit        uses_huge_pages;  /* regions that are at least a huge page are backed by huge pages */
 
 	region *active_region;
 	region *first_region;
 };
 
-void *push(uint size, uint alignment, regional_allocator *allocator);
+void *push              (uint size, uint alignment, regional_allocator *allocator);
+void *push_uninitialized(uint size, uint alignment, regional_allocator *allocator);
+
+#define PUSH(type, count, allocator)               (type *)push(count * sizeof(type), alignof(type), allocator)
+#define PUSH_UNINITIALIZED(type, count, allocator) (type *)push_uninitialized((count) * sizeof(type), alignof(type), allocator)
+#define PUSH_TRAIN(head, body, allocator)          (head *)push(sizeof(head) + sizeof(body), alignof(head), allocator)
+
+/* grows the latest push in place, if nothing was pushed after it. the grown
+   memory is uninitialized */
+bit extend(void *memory, uint size, uint additional_size, regional_allocator *allocator);
+
+#define EXTEND(memory, count, additional_count, allocator) extend(memory, (count) * sizeof(typeof(*(memory))), (additional_count) * sizeof(typeof(*(memory))), allocator)
+
+#if defined(CODE_PROFILING_ALLOCATIONS)
+	/* every allocation is attributed to its call site and allocator, and a
+	   table of them is printed at exit */
+	void *_profile_push              (const char *file, uint line, uint size, uint alignment, regional_allocator *allocator);
+	void *_profile_push_uninitialized(const char *file, uint line, uint size, uint alignment, regional_allocator *allocator);
+	bit   _profile_extend            (const char *file, uint line, void *memory, uint size, uint additional_size, regional_allocator *allocator);
+	void *_profile_allocate          (const char *file, uint line, uint size);
+
+	#define push(...)               _profile_push(__FILE__, __LINE__, __VA_ARGS__)
+	#define push_uninitialized(...) _profile_push_uninitialized(__FILE__, __LINE__, __VA_ARGS__)
+	#define extend(...)             _profile_extend(__FILE__, __LINE__, __VA_ARGS__)
+	#define allocate(...)           _profile_allocate(__FILE__, __LINE__, __VA_ARGS__)
+#endif
+
+/* regions are recycled through a process-wide pool that's grouped by their
+   footprint (their header and capacity) */
+region *acquire_region(uint footprint, bit reserves, bit is_huge);
+void    release_region(region *region);
+
+/* releases all of the allocator's regions into the pool */
+void release_regions(regional_allocator *allocator);
+
+/* everything pushed in between beginning and ending a temporary is popped */
+typedef struct
+{
+	regional_allocator *allocator;
+	region             *region;
+	uint                mass;
+} temporary;
+
+temporary begin_temporary(regional_allocator *allocator);
+void      end_temporary  (temporary temporary);
 
-#define PUSH(type, count, allocator)      (type *)push(count * sizeof(type), alignof(type), allocator)
-#define PUSH_TRAIN(head, body, allocator) (head *)push(sizeof(head) + sizeof(body), alignof(head), allocator)
+/* gets one of the context's allocators that isn't `conflict` */
+regional_allocator *get_scratch_allocator(const regional_allocator *conflict);
+
+typedef struct trace_buffer trace_buffer;
 
 extern thread_local struct context
 {
 	regional_allocator allocators[2];
 
+	trace_buffer *trace_buffer;
+
 	landing default_failure_landing;
 	landing *failure_landing;
 } context;
@@ -313,13 +448,38 @@ extern struct base
 
 	utf8 *command_line;
 	uint  command_line_size;
+
+	const utf8 *trace_path;
+
+	/* counted over the life of the process, by every thread */
+	_Atomic(uintl) acquired_regions_count;
+	_Atomic(uintl) recycled_regions_count; /* of the acquired ones, those that came from the pool */
 } base;
 
+/* 
+	identifiers are interned into symbols by any thread, and the symbols are numbered densely from zero in
+	the order that their texts were first interned. the texts are kept for the life of the process.
+*/
+typedef uint32 symbol;
+
+constexpr symbol symbol_none = uint32_maximum; /* what's interned once the table is full */
+
+symbol      intern_symbol  (const utf8 *text, uint size);
+const utf8 *get_symbol_text(symbol symbol, uint *size);
+
 uintl get_time(void);
 
+uint get_thread_identifier(void);
+
+#if defined(CODE_ON_PLATFORM_WIN32)
 constexpr uint maximum_size_of_path = MAX_PATH;
 
 typedef void *file_handle;
+#elif defined(CODE_ON_PLATFORM_LINUX)
+constexpr uint maximum_size_of_path = PATH_MAX;
+
+typedef int file_handle;
+#endif
 
 uint get_current_directory_path(utf8 *path);
 
@@ -329,7 +489,28 @@ file_handle open_file  (const utf8 *path);
 uintl get_size_of_file(file_handle handle);
 
 uint read_from_file(void *buffer, uint size, file_handle handle);
+uint write_to_file (const void *buffer, uint size, file_handle handle);
+
+/* maps the file read-only with an ETX right after its contents, or returns 0
+   if that's impossible */
+const utf8 *map_file  (file_handle handle, uint size);
+void        unmap_file(const utf8 *view, uint size);
 
 void close_file(file_handle handle);
 
+/* events are buffered per thread, and written to `base.trace_path` as a
+   chrome trace at exit */
+void start_tracing(const utf8 *path);
+void _trace(const utf8 *name, const utf8 *file, sint index, bit is_ending);
+
+/* a failure jumps past the ends of the events it's in, so they're ended on its landing,
+   down to the depth that was taken before */
+uint _get_trace_depth(void);
+void _unwind_trace(uint depth);
+
+#define TRACE_BEGIN(name, file, index) do { if (UNLIKELY(base.trace_path != 0)) _trace(name, file, index, 0); } while (0)
+#define TRACE_END(name, file, index)   do { if (UNLIKELY(base.trace_path != 0)) _trace(name, file, index, 1); } while (0)
+#define TRACE_DEPTH()                  (UNLIKELY(base.trace_path != 0) ? _get_trace_depth() : 0)
+#define TRACE_UNWIND(depth)            do { if (UNLIKELY(base.trace_path != 0)) _unwind_trace(depth); } while (0)
+
 #endif
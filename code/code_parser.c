@@ -1,15 +1,81 @@
 #include "code_parser.h"
 
-static void report_source_v(severity severity, const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, vargs vargs)
+/* only what is reported needs rows and columns, so they are found from the offsets of the lines when asked for */
+void build_line_index(const utf8 *source, uint source_size, line_index *result, regional_allocator *allocator)
 {
+	uint count = 1;
+	uint index = 0;
+#if defined(VECTOR_SIZE)
+	for (; index + VECTOR_SIZE <= source_size; index += VECTOR_SIZE)
+	{
+		count += __builtin_popcount(VECTOR_MASK(VECTOR_EQUAL(VECTOR_LOAD(source + index), VECTOR_SPLAT('\n'))));
+	}
+#endif
+	for (; index < source_size; ++index) count += source[index] == '\n';
+
+	uint *beginnings = PUSH_UNINITIALIZED(uint, count, allocator);
+	uint *caret = beginnings;
+	*caret++ = 0;
+	index = 0;
+#if defined(VECTOR_SIZE)
+	for (; index + VECTOR_SIZE <= source_size; index += VECTOR_SIZE)
+	{
+		for (uint mask = VECTOR_MASK(VECTOR_EQUAL(VECTOR_LOAD(source + index), VECTOR_SPLAT('\n'))); mask; mask &= mask - 1)
+		{
+			*caret++ = index + __builtin_ctz(mask) + 1;
+		}
+	}
+#endif
+	for (; index < source_size; ++index)
+	{
+		if (source[index] == '\n') *caret++ = index + 1;
+	}
+
+	result->beginnings = beginnings;
+	result->count      = count;
+}
+
+void locate_in_line_index(uint offset, const utf8 *source, const line_index *lines, uint *row, uint *column)
+{
+	/* the last line that begins at or before the offset */
+	uint low  = 0;
+	uint high = lines->count;
+	while (high - low > 1)
+	{
+		uint middle = low + (high - low) / 2;
+		if (lines->beginnings[middle] <= offset) low = middle;
+		else high = middle;
+	}
+
+	/* columns count runes, so the bytes that continue one do not count */
+	uint beginning = lines->beginnings[low];
+	uint continuations_count = 0;
+	for (uint i = beginning; i < offset; ++i) continuations_count += (source[i] & 0xC0) == 0x80;
+
+	*row    = low + 1;
+	*column = offset - beginning - continuations_count + 1;
+}
+
+static const line_index *parser_get_line_index(parser *parser)
+{
+	if (!parser->lines.beginnings) build_line_index(parser->source, parser->source_size, &parser->lines, &parser->lines_allocator);
+	return &parser->lines;
+}
+
+static void report_source_v(severity severity, const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, vargs vargs)
+{
+	uint row;
+	uint column;
+	locate_in_line_index(beginning, source, lines, &row, &column);
+
 	fprintf(stderr, "[%s] %s(%u|%u:%u): ", severity_representations[severity], source_path, beginning, row, column);
 	vfprintf(stderr, message, vargs);
 	fputc('\n', stderr);
 
-	if (beginning == ending) return;
+	if (beginning >= ending) return;
 
 	/* begin from the beginning of the line */
-	const utf8 *caret = source + beginning - column + 1;
+	const utf8 *caret = source + lines->beginnings[row - 1];
 
 	/* print up to the beginning */
 	fprintf(stderr, "\t%u | ", row++);
@@ -36,20 +102,20 @@ static void report_source_v(severity severity, const utf8 *source_path, const ut
 	fprintf(stderr, "\x1b[0m");
 
 	/* print to the end of the line, or end of the source */
-	while (*caret != '\n' && *caret != '\0') fputc(*caret++, stderr);
-	printf("\n\n", stderr);
+	while (caret != source + source_size && *caret != '\n') fputc(*caret++, stderr);
+	fprintf(stderr, "\n\n");
 
 	fflush(stderr);
 }
 
-static inline void report_source(severity severity, const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity, source_path, source, beginning, ending, row, column, message, vargs); END_VARGS(vargs); }
+static inline void report_source(severity severity, const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity, source_path, source, source_size, lines, beginning, ending, message, vargs); END_VARGS(vargs); }
 
-static inline void report_source_verbose(const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_verbose, source_path, source, beginning, ending, row, column, message, vargs); END_VARGS(vargs); }
-static inline void report_source_comment(const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_comment, source_path, source, beginning, ending, row, column, message, vargs); END_VARGS(vargs); }
-static inline void report_source_caution(const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_caution, source_path, source, beginning, ending, row, column, message, vargs); END_VARGS(vargs); }
-static inline void report_source_failure(const utf8 *source_path, const utf8 *source, uint beginning, uint ending, uint row, uint column, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_failure, source_path, source, beginning, ending, row, column, message, vargs); END_VARGS(vargs); }
+static inline void report_source_verbose(const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_verbose, source_path, source, source_size, lines, beginning, ending, message, vargs); END_VARGS(vargs); }
+static inline void report_source_comment(const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_comment, source_path, source, source_size, lines, beginning, ending, message, vargs); END_VARGS(vargs); }
+static inline void report_source_caution(const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_caution, source_path, source, source_size, lines, beginning, ending, message, vargs); END_VARGS(vargs); }
+static inline void report_source_failure(const utf8 *source_path, const utf8 *source, uint source_size, const line_index *lines, uint beginning, uint ending, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); report_source_v(severity_failure, source_path, source, source_size, lines, beginning, ending, message, vargs); END_VARGS(vargs); }
 
-static inline void parser_report_v(severity severity, parser *parser, const utf8 *message, vargs vargs) { report_source_v(severity, parser->source_path, parser->source, parser->token.beginning, parser->token.ending, parser->token.row, parser->token.column, message, vargs); }
+static inline void parser_report_v(severity severity, parser *parser, const utf8 *message, vargs vargs) { report_source_v(severity, parser->source_path, parser->source, parser->source_size, parser_get_line_index(parser), parser->token.beginning, parser->token.ending, message, vargs); }
 static inline void parser_report(severity severity, parser *parser, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); parser_report_v(severity, parser, message, vargs); END_VARGS(vargs); }
 
 static inline void parser_report_verbose(parser *parser, const utf8 *message, ...) { vargs vargs; GET_VARGS(vargs, message); parser_report_v(severity_verbose, parser, message, vargs); END_VARGS(vargs); }
@@ -59,23 +125,15 @@ static inline void parser_report_failure(parser *parser, const utf8 *message, ..
 
 static uintb parser_peek(utf32 *rune, parser *parser)
 {
-	sintb increment;
+	uintb increment;
 	uint peek_position = parser->position + parser->increment;
 	if (peek_position >= parser->source_size)
 	{
 		*rune = '\x3';
 		increment = 0;
 	}
-	/* WARN: this can segfault */
-	else
-	{
-		increment = decode_utf8(rune, parser->source + peek_position);
-		if (increment < 0)
-		{
-			report_source_failure(parser->source_path, parser->source, parser->position, parser->position + -increment, parser->row, parser->column, "Unknown rune.");
-			jump(*parser->failure_landing, 1);
-		}
-	}
+	/* parser_load validated the whole source, so no rune here is malformed or cut off */
+	else increment = decode_valid_utf8(rune, parser->source + peek_position);
 	return increment;
 }
 
@@ -85,12 +143,6 @@ static utf32 parser_advance(parser *parser)
 	uintb increment = parser_peek(&rune, parser);
 
 	parser->position += parser->increment;
-	if (parser->rune == '\n')
-	{
-		parser->row += 1;
-		parser->column = 0;
-	}
-	parser->column += 1;
 	parser->rune = rune;
 	parser->increment = increment;
 	return rune;
@@ -111,6 +163,178 @@ static inline bit is_digit(utf32 rune)
 	return rune >= '0' && rune <= '9';
 }
 
+/* the runes beyond ascii are classified by the unicode tables, ascii by the ones below */
+static const bits64 xid_blocks[][8] =
+{
+#define BLOCK(...) { __VA_ARGS__ },
+#define INDICES(...)
+#include "code_xid.inc"
+#undef INDICES
+#undef BLOCK
+};
+
+static const uint8 xid_block_indices[0x1100] =
+{
+#define BLOCK(...)
+#define INDICES(...) __VA_ARGS__,
+#include "code_xid.inc"
+#undef INDICES
+#undef BLOCK
+};
+
+static inline uint get_xid_class(utf32 rune)
+{
+	ASSERT(rune <= 0x10FFFF);
+	bits64 word = xid_blocks[xid_block_indices[rune >> 8]][(rune >> 5) & 7];
+	return (word >> ((rune & 31) * 2)) & 3;
+}
+
+static inline bit is_xid_start(utf32 rune)
+{
+	return get_xid_class(rune) == 3;
+}
+
+static inline bit is_xid_continue(utf32 rune)
+{
+	return get_xid_class(rune) != 0;
+}
+
+static inline bit is_identifier_byte(utf8 byte)
+{
+	return is_letter(byte) || is_digit(byte) || byte == '_' || byte == '-';
+}
+
+static inline bit is_digital_byte(utf8 byte)
+{
+	return is_digit(byte) || byte == '_';
+}
+
+static inline bit is_hexadecimal_byte(utf8 byte)
+{
+	return is_digital_byte(byte) || ((byte | 0x20) >= 'a' && (byte | 0x20) <= 'f');
+}
+
+/* 
+	these return the size of the run of bytes of a class at the beginning of a text,
+	a vector at a time while a whole one fits, and a byte at a time for the tail.
+*/
+#if defined(VECTOR_SIZE)
+	#define SCAN_VECTORS(text, size, count, classify) \
+		for (; count + VECTOR_SIZE <= size; count += VECTOR_SIZE) \
+		{ \
+			vector bytes = VECTOR_LOAD(text + count); \
+			uint mask = VECTOR_MASK(classify(bytes)); \
+			if (mask != VECTOR_FULL_MASK) return count + __builtin_ctz(~mask); \
+		}
+
+	#define CLASSIFY_WHITESPACE(x) VECTOR_OR(VECTOR_IN_RANGE(x, '\t', '\r'), VECTOR_EQUAL(x, VECTOR_SPLAT(' ')))
+	#define CLASSIFY_DIGITAL(x)    VECTOR_OR(VECTOR_IN_RANGE(x, '0', '9'), VECTOR_EQUAL(x, VECTOR_SPLAT('_')))
+	#define CLASSIFY_HEXADECIMAL(x) VECTOR_OR(VECTOR_IN_RANGE(VECTOR_OR(x, VECTOR_SPLAT(0x20)), 'a', 'f'), CLASSIFY_DIGITAL(x))
+	/* or-ing in 0x20 folds the uppercase letters onto the lowercase ones, and nothing else onto them */
+	#define CLASSIFY_IDENTIFIER(x) VECTOR_OR(VECTOR_OR(VECTOR_IN_RANGE(VECTOR_OR(x, VECTOR_SPLAT(0x20)), 'a', 'z'), CLASSIFY_DIGITAL(x)), VECTOR_EQUAL(x, VECTOR_SPLAT('-')))
+	#define CLASSIFY_LINE(x)       VECTOR_GREATER(VECTOR_EQUAL(x, VECTOR_SPLAT('\n')), VECTOR_SPLAT(-1))
+	#define CLASSIFY_TEXT(x)       VECTOR_GREATER(VECTOR_OR(VECTOR_EQUAL(x, VECTOR_SPLAT('"')), VECTOR_EQUAL(x, VECTOR_SPLAT('\\'))), VECTOR_SPLAT(-1))
+#else
+	#define SCAN_VECTORS(text, size, count, classify)
+#endif
+
+static uint scan_whitespace(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_WHITESPACE);
+	while (count < size && is_whitespace(text[count])) count += 1;
+	return count;
+}
+
+static uint scan_identifier(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_IDENTIFIER);
+	while (count < size && is_identifier_byte(text[count])) count += 1;
+	return count;
+}
+
+static uint scan_digital(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_DIGITAL);
+	while (count < size && is_digital_byte(text[count])) count += 1;
+	return count;
+}
+
+static uint scan_hexadecimal(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_HEXADECIMAL);
+	while (count < size && is_hexadecimal_byte(text[count])) count += 1;
+	return count;
+}
+
+/* up to a `"` or a `\\` */
+static uint scan_text(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_TEXT);
+	while (count < size && text[count] != '"' && text[count] != '\\') count += 1;
+	return count;
+}
+
+static uint scan_line(const utf8 *text, uint size)
+{
+	uint count = 0;
+	SCAN_VECTORS(text, size, count, CLASSIFY_LINE);
+	while (count < size && text[count] != '\n') count += 1;
+	return count;
+}
+
+/* advances over all the runes up to a position at once, as if parser_advance was called for each */
+static void parser_leap(uint position, parser *parser)
+{
+	ASSERT(position >= parser->position && position <= parser->source_size);
+	parser->position  = position;
+	parser->increment = 0;
+	parser->increment = parser_peek(&parser->rune, parser);
+}
+
+typedef enum : uintb
+{
+	character_class_other,
+	character_class_whitespace,
+	character_class_letter,
+	character_class_digit,
+	character_class_quotation_mark,
+	character_class_etx,
+} character_class;
+
+constexpr character_class character_classes[128] =
+{
+	['\t' ... '\r'] = character_class_whitespace,
+	[' ']           = character_class_whitespace,
+	['A' ... 'Z']   = character_class_letter,
+	['a' ... 'z']   = character_class_letter,
+	['_']           = character_class_letter,
+	['0' ... '9']   = character_class_digit,
+	['"']           = character_class_quotation_mark,
+	['\3']          = character_class_etx,
+};
+
+/* what a token becomes when followed by a character, unknown if it ends before it */
+constexpr token_tag token_continuations[256][128] =
+{
+#define X(identifier, code, representation, prefix, suffix) [token_tag_##prefix][suffix] = token_tag_##identifier,
+	#include "code_tokens.inc"
+#undef X
+};
+
+/* the byte is taken unsigned, as utf8 is signed and the bytes beyond ascii would index before the row */
+static inline token_tag get_token_continuation(token_tag tag, uint8 character)
+{
+	return character < 128 ? token_continuations[tag][character] : token_tag_unknown;
+}
+
+/* the arena of a source this big is in the hundreds of megabytes */
+constexpr uint minimum_source_size_for_huge_pages = MIB(16);
+
 static void parser_load(const utf8 *source_path, parser *parser)
 {
 	REPORT_VERBOSE("Loading source: %s\n", source_path);
@@ -118,258 +342,168 @@ static void parser_load(const utf8 *source_path, parser *parser)
 	parser->source_path = source_path;
 	file_handle source_file = open_file(parser->source_path);
 	parser->source_size = get_size_of_file(source_file);
-	parser->source = push(align_forward(parser->source_size + 1, sizeof(utf32)), universal_alignment, &parser->allocator);
-	read_from_file(parser->source, parser->source_size, source_file);
+	if (parser->source_size >= minimum_source_size_for_huge_pages) parser->allocator.uses_huge_pages = 1;
+	parser->source = map_file(source_file, parser->source_size);
+	parser->source_is_mapped = parser->source != 0;
+	if (!parser->source)
+	{
+		utf8 *source = push_uninitialized(align_forward(parser->source_size + 1, sizeof(utf32)), universal_alignment, &parser->allocator);
+		read_from_file(source, parser->source_size, source_file);
+		source[parser->source_size] = '\3';
+		parser->source = source;
+	}
 	close_file(source_file);
-	parser->source[parser->source_size] = '\3';
+
+	uint malformation = validate_utf8(parser->source, parser->source_size);
+	if (malformation != parser->source_size)
+	{
+		report_source_failure(parser->source_path, parser->source, parser->source_size, parser_get_line_index(parser), malformation, malformation + 1, "Malformed UTF-8.");
+		jump(*parser->failure_landing, 1);
+	}
 
 	parser->position  = 0;
-	parser->row       = 0;
-	parser->rune      = '\n';
 	parser->increment = 0;
-	parser_advance(parser);
+	parser->increment = parser_peek(&parser->rune, parser);
 }
 
-static token_tag parser_get_token(parser *parser)
+static token_tag parser_lex_token(parser *parser)
 {
 repeat:
-	while (is_whitespace(parser->rune)) parser_advance(parser);
+	if (is_whitespace(parser->rune))
+	{
+		parser_leap(parser->position + scan_whitespace(parser->source + parser->position, parser->source_size - parser->position), parser);
+	}
 
 	parser->token.beginning = parser->position;
-	parser->token.row       = parser->row;
-	parser->token.column    = parser->column;
-
-	utf32 peeked_rune;
-	uintb peeked_increment = parser_peek(&peeked_rune, parser);
 
-	switch (parser->rune)
+	switch (parser->rune < 128 ? character_classes[parser->rune] : is_xid_start(parser->rune) ? character_class_letter : character_class_other)
 	{
-	case '\3':
+	case character_class_etx:
+		/* this is never advanced over, so every token after the end is an etx */
 		parser->token.tag = token_tag_etx;
 		break;
-	case '!':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_exclamation_mark_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '%':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_percent_sign_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '&':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_ampersand_equal_sign;
-			goto advance_twice;
-		}
-		else if (peeked_rune == '&')
-		{
-			parser->token.tag = token_tag_ampersand_2;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '*':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_asterisk_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '+':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_plus_sign_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '-':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_minus_sign_equal_sign;
-			goto advance_twice;
-		}
-		else if (peeked_rune == '>')
-		{
-			parser->token.tag = token_tag_minus_sign_greater_than_sign;
-			goto advance_twice;
-		}
-		else if (peeked_rune == '-')
-		{
-			do parser_advance(parser);
-			while (parser->rune != '\n');
-			goto repeat;
-		}
-		else goto set_single;
-	case '/':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_slash_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '<':
-		if (peeked_rune == '<')
+	case character_class_letter:
+		/* the ascii runs are scanned in bulk, and the runes between them are looked up one at a time */
+		for (;;)
 		{
+			parser_leap(parser->position + scan_identifier(parser->source + parser->position, parser->source_size - parser->position), parser);
+			if (parser->rune < 128 || !is_xid_continue(parser->rune)) break;
 			parser_advance(parser);
-			peeked_increment = parser_peek(&peeked_rune, parser);
-			if (peeked_rune == '=')
-			{
-				parser->token.tag = token_tag_less_than_sign_2_equal_sign;
-			}
-			else parser->token.tag = token_tag_less_than_sign_2;
-			goto advance_twice;
-		}
-		else if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_less_than_sign_equal_sign;
-			goto advance_twice;
 		}
-		else goto set_single;
-	case '=':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_equal_sign_2;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '>':
-		if (peeked_rune == '>')
+		parser->token.tag = token_tag_identifier;
+		break;
+	case character_class_digit:
+		parser->token.tag = token_tag_digital;
+		if (parser->rune == '0')
 		{
-			parser_advance(parser);
-			peeked_increment = parser_peek(&peeked_rune, parser);
-			if (peeked_rune == '=')
+			/* the source ends in an etx, so the byte after the zero is there */
+			uint position = parser->position;
+			switch (parser->source[position + 1])
 			{
-				parser->token.tag = token_tag_greater_than_sign_2_equal_sign;
-				goto advance_twice;
+			case 'x':
+				parser->token.tag = token_tag_hexadecimal;
+				position += 2;
+				parser_leap(position + scan_hexadecimal(parser->source + position, parser->source_size - position), parser);
+				break;
+			case 'b':
+				/* the digits that aren't binary are refused when decoded */
+				parser->token.tag = token_tag_binary;
+				position += 2;
+				parser_leap(position + scan_digital(parser->source + position, parser->source_size - position), parser);
+				break;
+			default:
+				break;
 			}
-			else parser->token.tag = token_tag_greater_than_sign_2;
-			goto advance_twice;
 		}
-		else if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_greater_than_sign_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '^':
-		if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_circumflex_accent_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '|':
-		if (peeked_rune == '|')
-		{
-			parser->token.tag = token_tag_vertical_bar_2;
-			goto advance_twice;
-		}
-		else if (peeked_rune == '=')
-		{
-			parser->token.tag = token_tag_vertical_bar_equal_sign;
-			goto advance_twice;
-		}
-		else goto set_single;
-	case '"':
-		for (;;)
+
+		while (is_digit(parser->rune) || parser->rune == '_' || parser->rune == '.')
 		{
-			parser_advance(parser);
-			if (parser->rune == '"') break;
-			if (parser->rune == '\\')
+			if (parser->rune == '.')
 			{
-				switch (parser_advance(parser))
+				switch (parser->token.tag)
 				{
+				case token_tag_binary:
+				case token_tag_hexadecimal:
+				case token_tag_decimal:
+				case token_tag_scientific:
+					while (!is_whitespace(parser->rune) && parser->rune != '\3') parser_advance(parser);
+					parser->token.ending = parser->position;
+					parser_report_failure(parser, "Weird ass number.");
+					goto failed;
 				default:
-					parser_advance(parser);
 					break;
 				}
+				parser->token.tag = token_tag_decimal;
+				parser_advance(parser);
 			}
+			else parser_leap(parser->position + scan_digital(parser->source + parser->position, parser->source_size - parser->position), parser);
 		}
-		parser_advance(parser); /* skip the terminating `"` */
-		parser->token.tag = token_tag_text;
-		break;
-	case '#':
-	case '$':
-	case '(':
-	case ')':
-	case ',':
-	case '.':
-	case ':':
-	case ';':
-	case '?':
-	case '@':
-	case '[':
-	case '\\':
-	case ']':
-	case '`':
-	case '{':
-	case '}':
-	case '~':
-	set_single:
-		parser->token.tag = (token_tag)parser->rune;
-		goto advance_once;
-
-	advance_twice:
-		parser_advance(parser);
-	advance_once:
-		parser_advance(parser);
-		break;
 
-	default:
-		if (is_letter(parser->rune) || parser->rune == '_')
-		{
-			do parser_advance(parser);
-			while (is_letter(parser->rune) || parser->rune == '_' || parser->rune == '-' || is_digit(parser->rune));
-			parser->token.tag = token_tag_identifier;
-		}
-		else if (is_digit(parser->rune))
+		/* an exponent needs a digit after its sign, otherwise the `e` begins an identifier */
+		if ((parser->token.tag == token_tag_digital || parser->token.tag == token_tag_decimal) && (parser->rune | 0x20) == 'e')
 		{
-			parser->token.tag = token_tag_digital;
-#if 0
-			if (parser->rune == '0')
+			const utf8 *source = parser->source;
+			uint position = parser->position + 1;
+			if (source[position] == '+' || source[position] == '-') position += 1;
+			if (is_digit(source[position]))
 			{
-				parser_advance(parser);
-				switch (parser->rune)
-				{
-				case 'b': parser->token.tag = token_tag_binary; break;
-				case 'x': parser->token.tag = token_tag_hexadecimal; break;
-				default: break;
-				}
+				parser->token.tag = token_tag_scientific;
+				parser_leap(position + scan_digital(source + position, parser->source_size - position), parser);
 			}
-#endif
-
-			while (is_digit(parser->rune) || parser->rune == '_' || parser->rune == '.')
+		}
+		break;
+	case character_class_quotation_mark:
+	{
+		/* only the end is found here, the escapes are decoded by parser_parse_text */
+		const utf8 *source = parser->source;
+		uint position = parser->position + 1;
+		for (;;)
+		{
+			position += scan_text(source + position, parser->source_size - position);
+			if (position >= parser->source_size)
 			{
-				if (parser->rune == '.')
-				{
-					switch (parser->token.tag)
-					{
-					case token_tag_binary:
-					case token_tag_hexadecimal:
-					case token_tag_decimal:
-					case token_tag_scientific:
-						parser_report_failure(parser, "Weird ass number.");
-						while (!is_whitespace(parser->rune)) parser_advance(parser);
-						goto failed;
-					default:
-						break;
-					}
-					parser->token.tag = token_tag_decimal;
-				}
-				parser_advance(parser);
+				parser->token.tag = token_tag_text;
+				parser_leap(parser->source_size, parser);
+				parser->token.ending = parser->position;
+				parser_report_failure(parser, "Unterminated text.");
+				goto failed;
 			}
+			if (source[position] == '"') break;
+			position = MINIMUM(position + 2, parser->source_size); /* skip the `\\` and what it escapes */
 		}
-		else
+		parser->token.tag = token_tag_text;
+		parser_leap(position + 1, parser);
+		break;
+	}
+	default:
+	{
+		/* the source ends in an etx, which continues no token, so this cannot run past it */
+		const utf8 *source = parser->source;
+		uint position = parser->position;
+		token_tag tag = get_token_continuation(token_tag_unknown, source[position]);
+		if (tag == token_tag_unknown)
 		{
 			parser->token.tag = token_tag_unknown;
 			parser_advance(parser);
+			parser->token.ending = parser->position;
 			parser_report_failure(parser, "Unknown token.");
+			break;
+		}
+		if (tag == token_tag_minus_sign && source[position + 1] == '-')
+		{
+			/* this stops at the line feed, or at the end of the source */
+			parser_leap(position + scan_line(source + position, parser->source_size - position), parser);
+			goto repeat;
+		}
+
+		position += 1;
+		for (token_tag continuation; (continuation = get_token_continuation(tag, source[position])) != token_tag_unknown; position += 1)
+		{
+			tag = continuation;
 		}
+		parser->token.tag = tag;
+		parser_leap(position, parser);
+	}
 	}
 	
 	parser->token.ending = parser->position;
@@ -380,6 +514,150 @@ failed:
 	jump(*parser->failure_landing, 1);
 }
 
+#define BEGIN_TIMING(parser) uintl timing_beginning = (parser)->options.collects_statistics ? get_time() : 0
+#define END_TIMING(parser, time) if ((parser)->options.collects_statistics) (parser)->statistics.time += get_time() - timing_beginning
+
+static token_tag parser_lex_token_and_count(parser *parser)
+{
+	if (LIKELY(!parser->options.collects_statistics)) return parser_lex_token(parser);
+
+	BEGIN_TIMING(parser);
+	token_tag tag = parser_lex_token(parser);
+	END_TIMING(parser, lexing_time);
+	parser->statistics.tokens_counts[tag] += 1;
+	return tag;
+}
+
+static token_tag parser_receive_token(parser *parser);
+
+/* the lexer's own state is left wherever this token ends, as the stream is read by index */
+static uint parser_lex_ending_again(uint beginning, parser *parser)
+{
+	parser->position  = beginning;
+	parser->increment = 0;
+	parser->increment = parser_peek(&parser->rune, parser);
+	parser_lex_token(parser);
+	return parser->token.ending;
+}
+
+static token_tag parser_get_token(parser *parser)
+{
+	if (parser->token_ring) return parser_receive_token(parser);
+	if (!parser->tokens.count) return parser_lex_token_and_count(parser);
+
+	/* stay on the etx once there */
+	const token_stream *tokens = &parser->tokens;
+	uint index = parser->next_token_index;
+	if (index + 1 < tokens->count) parser->next_token_index = index + 1;
+
+	uint beginning = tokens->beginnings[index];
+	uint length    = tokens->lengths[index];
+	parser->token.ending    = LIKELY(length != uint8_maximum) ? beginning + length : parser_lex_ending_again(beginning, parser);
+	parser->token.tag       = tokens->tags[index];
+	parser->token.beginning = beginning;
+	return parser->token.tag;
+}
+
+static token_tag parser_peek_received_token(uint distance, parser *parser);
+
+/* 
+	gives the tag of the token `distance` tokens after the current one, without getting to it, and the etx
+	for any past the end. it's free on a stream. otherwise, the tokens are lexed ahead, and lexed again
+	when they're got.
+*/
+static token_tag parser_peek_token(uint distance, parser *parser)
+{
+	if (!distance || parser->token.tag == token_tag_etx) return parser->token.tag;
+	if (parser->token_ring) return parser_peek_received_token(distance, parser);
+
+	const token_stream *tokens = &parser->tokens;
+	if (tokens->count) return tokens->tags[MINIMUM(parser->next_token_index + distance - 1, tokens->count - 1)];
+
+	uint  position  = parser->position;
+	utf32 rune      = parser->rune;
+	uintb increment = parser->increment;
+	token token     = parser->token;
+	token_tag tag;
+	do tag = parser_lex_token(parser);
+	while (--distance && tag != token_tag_etx);
+	parser->position  = position;
+	parser->rune      = rune;
+	parser->increment = increment;
+	parser->token     = token;
+	return tag;
+}
+
+constexpr uint token_chunk_capacity = 4096;
+
+typedef struct token_chunk token_chunk;
+struct token_chunk
+{
+	token_chunk *next;
+	uint         count;
+	token_tag    tags[token_chunk_capacity];
+	uint         beginnings[token_chunk_capacity];
+	uint8        lengths[token_chunk_capacity];
+};
+
+/* lexes into chunks on the scratch allocator, as the count of tokens isn't known until the end */
+static void parser_pretokenize(parser *parser)
+{
+	regional_allocator *scratch_allocator = get_scratch_allocator(&parser->allocator);
+	temporary temporary = begin_temporary(scratch_allocator);
+
+	/* a failure to lex ends the temporary on its way to the parser's landing */
+	landing *parser_failure_landing = parser->failure_landing;
+	landing failure_landing;
+	parser->failure_landing = &failure_landing;
+	if (SET_LANDING(failure_landing))
+	{
+		end_temporary(temporary);
+		parser->failure_landing = parser_failure_landing;
+		jump(*parser->failure_landing, 1);
+	}
+
+	token_chunk *first_chunk = PUSH_UNINITIALIZED(token_chunk, 1, scratch_allocator);
+	token_chunk *chunk = first_chunk;
+	chunk->next  = 0;
+	chunk->count = 0;
+	uint count = 0;
+	for (;;)
+	{
+		if (chunk->count == token_chunk_capacity)
+		{
+			chunk->next = PUSH_UNINITIALIZED(token_chunk, 1, scratch_allocator);
+			chunk = chunk->next;
+			chunk->next  = 0;
+			chunk->count = 0;
+		}
+		token_tag tag = parser_lex_token_and_count(parser);
+		chunk->tags      [chunk->count] = tag;
+		chunk->beginnings[chunk->count] = parser->token.beginning;
+		chunk->lengths   [chunk->count] = MINIMUM(parser->token.ending - parser->token.beginning, uint8_maximum);
+		chunk->count += 1;
+		count += 1;
+		if (tag == token_tag_etx) break;
+	}
+
+	token_stream *tokens = &parser->tokens;
+	tokens->beginnings = PUSH_UNINITIALIZED(uint,      count, &parser->allocator);
+	tokens->lengths    = PUSH_UNINITIALIZED(uint8,     count, &parser->allocator);
+	tokens->tags       = PUSH_UNINITIALIZED(token_tag, count, &parser->allocator);
+	uint index = 0;
+	for (chunk = first_chunk; chunk; chunk = chunk->next)
+	{
+		COPY(tokens->tags       + index, chunk->tags,       chunk->count);
+		COPY(tokens->beginnings + index, chunk->beginnings, chunk->count);
+		COPY(tokens->lengths    + index, chunk->lengths,    chunk->count);
+		index += chunk->count;
+	}
+	tokens->count = count;
+	parser->next_token_index = 0;
+
+	end_temporary(temporary);
+	parser->failure_landing = parser_failure_landing;
+}
+
 static void parser_ensure_token(token_tag tag, parser *parser)
 {
 	if (parser->token.tag != tag)
@@ -395,6 +673,172 @@ static void parser_expect_token(token_tag tag, parser *parser)
 	parser_ensure_token(tag, parser);
 }
 
+/* 
+	the lexer runs on its own copy of the parser, and publishes its tokens in batches,
+	so that the two threads share a cache line once per batch rather than once per token.
+*/
+constexpr uint token_ring_capacity   = 4096; /* a multiple of the batch size, and a power of two */
+constexpr uint token_ring_batch_size = 64;
+
+struct token_ring
+{
+	/* the lexer's side */
+	alignas(64) uint lexed_count;
+	uint             known_received_count;
+	parser          *lexer;
+	thrd_t           lexer_thread;
+
+	/* the parser's side */
+	alignas(64) uint received_count;
+	uint             known_published_count;
+
+	alignas(64) atomic_uint published_count;
+	alignas(64) atomic_uint received_count_of_parser;
+	alignas(64) atomic_bool lexer_failed;
+	atomic_bool             is_cancelled;
+
+	token tokens[token_ring_capacity];
+};
+
+/* spins a little before giving the core away, as the other side is usually about to publish */
+static inline void wait_on_token_ring(uint *attempts_count)
+{
+	*attempts_count += 1;
+	if (*attempts_count < 64)
+	{
+#if defined(__SSE2__)
+		_mm_pause();
+#endif
+	}
+	else thrd_yield();
+}
+
+/* waits while the ring is full, and returns 0 if the parser gave up meanwhile */
+static bit token_ring_put(const token *token, token_ring *ring)
+{
+	for (uint attempts_count = 0; ring->lexed_count - ring->known_received_count == token_ring_capacity;)
+	{
+		atomic_store_explicit(&ring->published_count, ring->lexed_count, memory_order_release);
+		ring->known_received_count = atomic_load_explicit(&ring->received_count_of_parser, memory_order_acquire);
+		if (ring->lexed_count - ring->known_received_count < token_ring_capacity) break;
+		if (atomic_load_explicit(&ring->is_cancelled, memory_order_relaxed)) return 0;
+		wait_on_token_ring(&attempts_count);
+	}
+
+	ring->tokens[ring->lexed_count & (token_ring_capacity - 1)] = *token;
+	ring->lexed_count += 1;
+	if (token->tag == token_tag_etx || ring->lexed_count % token_ring_batch_size == 0)
+	{
+		atomic_store_explicit(&ring->published_count, ring->lexed_count, memory_order_release);
+		if (atomic_load_explicit(&ring->is_cancelled, memory_order_relaxed)) return 0;
+	}
+	return 1;
+}
+
+static int lex_into_token_ring(void *argument)
+{
+	token_ring *ring = argument;
+	parser *lexer = ring->lexer;
+	TRACE_BEGIN("lex", lexer->source_path, -1);
+
+	landing failure_landing;
+	lexer->failure_landing = &failure_landing;
+	if (SET_LANDING(failure_landing))
+	{
+		/* the parser checks for this when it gets to the etx */
+		atomic_store_explicit(&ring->lexer_failed, 1, memory_order_relaxed);
+		lexer->token.tag = token_tag_etx;
+		token_ring_put(&lexer->token, ring);
+	}
+	else
+	{
+		do parser_lex_token_and_count(lexer);
+		while (token_ring_put(&lexer->token, ring) && lexer->token.tag != token_tag_etx);
+	}
+
+	TRACE_END("lex", lexer->source_path, -1);
+	return 0;
+}
+
+static token_tag parser_receive_token(parser *parser)
+{
+	token_ring *ring = parser->token_ring;
+	for (uint attempts_count = 0; ring->received_count == ring->known_published_count;)
+	{
+		ring->known_published_count = atomic_load_explicit(&ring->published_count, memory_order_acquire);
+		if (ring->received_count == ring->known_published_count) wait_on_token_ring(&attempts_count);
+	}
+
+	parser->token = ring->tokens[ring->received_count & (token_ring_capacity - 1)];
+	if (parser->token.tag == token_tag_etx)
+	{
+		/* stay on the etx once there */
+		if (atomic_load_explicit(&ring->lexer_failed, memory_order_relaxed)) jump(*parser->failure_landing, 1);
+	}
+	else
+	{
+		ring->received_count += 1;
+		if (ring->received_count % token_ring_batch_size == 0)
+		{
+			atomic_store_explicit(&ring->received_count_of_parser, ring->received_count, memory_order_release);
+		}
+	}
+	return parser->token.tag;
+}
+
+/* the lexer may be held back by the batch the parser hasn't acknowledged yet, so the peek stays short of that */
+static token_tag parser_peek_received_token(uint distance, parser *parser)
+{
+	ASSERT(distance <= token_ring_capacity - token_ring_batch_size);
+	token_ring *ring = parser->token_ring;
+	token_tag tag = parser->token.tag;
+	for (uint i = 0; i < distance && tag != token_tag_etx; ++i)
+	{
+		for (uint attempts_count = 0; ring->known_published_count - ring->received_count <= i;)
+		{
+			ring->known_published_count = atomic_load_explicit(&ring->published_count, memory_order_acquire);
+			if (ring->known_published_count - ring->received_count <= i) wait_on_token_ring(&attempts_count);
+		}
+		tag = ring->tokens[(ring->received_count + i) & (token_ring_capacity - 1)].tag;
+	}
+	return tag;
+}
+
+/* if the thread can't be had, the parser just lexes by itself */
+static void parser_begin_pipeline(parser *parser)
+{
+	token_ring *ring = PUSH(token_ring, 1, &parser->allocator);
+	typeof(*parser) *lexer = PUSH(typeof(*parser), 1, &parser->allocator);
+	*lexer = *parser;
+	ZERO(&lexer->allocator, 1);
+	lexer->allocator.reservation_size = default_reservation_size_of_regional_allocator;
+	ring->lexer = lexer;
+
+	if (thrd_create(&ring->lexer_thread, lex_into_token_ring, ring) != thrd_success)
+	{
+		REPORT_CAUTION("Couldn't create a lexing thread, so not pipelining.\n");
+		return;
+	}
+	parser->token_ring = ring;
+}
+
+/* also stops the lexer early, if the parser failed */
+static void parser_end_pipeline(parser *parser)
+{
+	token_ring *ring = parser->token_ring;
+	if (!ring) return;
+
+	atomic_store_explicit(&ring->is_cancelled, 1, memory_order_relaxed);
+	thrd_join(ring->lexer_thread, 0);
+	parser->token_ring = 0;
+
+	parser_statistics *statistics = &ring->lexer->statistics;
+	parser->statistics.lexing_time += statistics->lexing_time;
+	for (uint i = 0; i < COUNT(statistics->tokens_counts); ++i) parser->statistics.tokens_counts[i] += statistics->tokens_counts[i];
+	release_regions(&ring->lexer->allocator);
+	release_regions(&ring->lexer->lines_allocator);
+}
+
 typedef uint precedence;
 
 constexpr precedence precedences[] =
@@ -462,49 +906,98 @@ constexpr precedence precedences[] =
 	[node_tag_list] = 1,
 };
 
-static node *parser_parse_node(precedence precedence, parser *parser);
+/* grows an array that's alone on its allocator, which is in place until the allocator's reservation runs out */
+static void *grow_pool(void *pool, uint *capacity, uint element_size, regional_allocator *allocator)
+{
+	uint additional_capacity = MAXIMUM(*capacity / 2, 1024);
+	if (!pool || !extend(pool, *capacity * element_size, additional_capacity * element_size, allocator))
+	{
+		void *new_pool = push_uninitialized((*capacity + additional_capacity) * element_size, universal_alignment, allocator);
+		if (pool) copy(new_pool, pool, *capacity * element_size);
+		pool = new_pool;
+	}
+	*capacity += additional_capacity;
+	return pool;
+}
+
+/* the payloads move as they grow, so they're only written to after the nodes under them are parsed */
+static node_reference parser_push_node(node_tag tag, parser *parser)
+{
+	program *program = parser->program;
+	if (program->nodes_count == parser->nodes_capacity)
+	{
+		uint nodes_capacity = parser->nodes_capacity;
+		program->node_tags     = grow_pool(program->node_tags,     &nodes_capacity,         sizeof(node_tag),     &parser->node_tags_allocator);
+		program->node_payloads = grow_pool(program->node_payloads, &parser->nodes_capacity, sizeof(node_payload), &parser->node_payloads_allocator);
+	}
+	node_reference reference = program->nodes_count++;
+	program->node_tags    [reference] = tag;
+	program->node_payloads[reference] = (node_payload){};
+	return reference;
+}
 
-static void parser_parse_scope     (scope_node      *result, parser *parser);
+static uint parser_push_constant(node_constant constant, parser *parser)
+{
+	program *program = parser->program;
+	if (program->constants_count == parser->constants_capacity)
+	{
+		program->constants = grow_pool(program->constants, &parser->constants_capacity, sizeof(node_constant), &parser->constants_allocator);
+	}
+	program->constants[program->constants_count] = constant;
+	return program->constants_count++;
+}
+
+static node_reference parser_parse_node(precedence precedence, parser *parser);
+
+static scope_node parser_parse_scope (bit is_global, parser *parser);
 static void parser_parse_identifier(identifier_node *result, parser *parser);
 static void parser_parse_text      (text_node       *result, parser *parser);
 static void parser_parse_digital   (digital_node    *result, parser *parser);
 static void parser_parse_decimal   (decimal_node    *result, parser *parser);
 
-node *parser_parse_node(precedence left_precedence, parser *parser)
+node_reference parser_parse_node(precedence left_precedence, parser *parser)
 {
+	program *program = parser->program;
+
 	/* parse the _possibly left_ node */
-	node *left = 0;
+	node_reference left = 0;
 	{
 		node_tag left_tag;
 		switch (parser->token.tag)
 		{
 			/* pragma */
 		case token_tag_octothorpe:
-			left = PUSH_TRAIN(node, pragma_node, &parser->allocator);
-			left->tag = node_tag_pragma;
+		{
+			left = parser_push_node(node_tag_pragma, parser);
 			parser_expect_token(token_tag_identifier, parser);
+
+			/* the pragma's identifier isn't kept */
+			identifier_node identifier;
+			parser_parse_identifier(&identifier, parser);
+			pragma_code found_code = pragma_code_none;
+			for (pragma_code code = pragma_code_none + 1; code < pragma_codes_count; ++code)
 			{
-				identifier_node identifier;
-				parser_parse_identifier(&identifier, parser);
-				if (!COMPARE_LITERAL_TEXT_WITH_SIZED_TEXT("fp64", identifier.runes, identifier.runes_count))
-					left->data->pragma.code = pragma_code_fp64;
-				else
-					left->data->pragma.code = pragma_code_none;
+				if (identifier.symbol == parser->pragma_symbols[code]) found_code = code;
 			}
-			left->data->pragma.node = parser_parse_node(0, parser);
+
+			node_reference node = parser_parse_node(0, parser);
+			program->node_payloads[left].pragma = (pragma_node){ found_code, node };
 			break;
+		}
 			
 			/* scoped */
 		case token_tag_left_parenthesis:    left_tag = node_tag_subexpression; goto scoped;
 		case token_tag_left_square_bracket: left_tag = node_tag_indexation;    goto scoped;
 		scoped:
-			left = PUSH_TRAIN(node, unary_node, &parser->allocator);
-			left->tag = left_tag;
+		{
+			left = parser_push_node(left_tag, parser);
 			parser_get_token(parser); /* skip the onset */
-			left->data->unary.node = parser_parse_node(0, parser);
+			node_reference node = parser_parse_node(0, parser);
+			program->node_payloads[left].unary.node = node;
 			parser_ensure_token(left_tag == node_tag_subexpression ? token_tag_right_parenthesis : token_tag_right_square_bracket, parser);
 			parser_get_token(parser);
 			break;
+		}
 			
 			/* terminators */
 		case token_tag_etx:
@@ -520,11 +1013,13 @@ node *parser_parse_node(precedence left_precedence, parser *parser)
 		case token_tag_tilde:            left_tag = node_tag_bitwise_negation; goto unary;
 		case token_tag_at_sign:          left_tag = node_tag_reference;        goto unary;
 		unary:
-			left = PUSH_TRAIN(node, unary_node, &parser->allocator);
-			left->tag = left_tag;
+		{
+			left = parser_push_node(left_tag, parser);
 			parser_get_token(parser); /* skip the operator */
-			left->data->unary.node = parser_parse_node(precedences[left_tag], parser);
+			node_reference node = parser_parse_node(precedences[left_tag], parser);
+			program->node_payloads[left].unary.node = node;
 			break;
+		}
 
 			/* scope */
 		case token_tag_left_curly_bracket:
@@ -532,33 +1027,29 @@ node *parser_parse_node(precedence left_precedence, parser *parser)
 
 			/* identifier */
 		case token_tag_identifier:
-			left = PUSH_TRAIN(node, identifier_node, &parser->allocator);
-			left->tag = node_tag_identifier;
-			parser_parse_identifier(&left->data->identifier, parser);
+			left = parser_push_node(node_tag_identifier, parser);
+			parser_parse_identifier(&program->node_payloads[left].identifier, parser);
 			break;
 
 			/* text */
 		case token_tag_text:
-			left = PUSH_TRAIN(node, text_node, &parser->allocator);
-			left->tag = node_tag_text;
-			parser_parse_text(&left->data->text, parser);
+			left = parser_push_node(node_tag_text, parser);
+			parser_parse_text(&program->node_payloads[left].text, parser);
 			break;
 
 			/* digital */
 		case token_tag_binary:
 		case token_tag_digital:
 		case token_tag_hexadecimal:
-			left = PUSH_TRAIN(node, digital_node, &parser->allocator);
-			left->tag = node_tag_digital;
-			parser_parse_digital(&left->data->digital, parser);
+			left = parser_push_node(node_tag_digital, parser);
+			parser_parse_digital(&program->node_payloads[left].digital, parser);
 			break;
 			
 			/* decimal */
 		case token_tag_decimal:
 		case token_tag_scientific:
-			left = PUSH_TRAIN(node, decimal_node, &parser->allocator);
-			left->tag = node_tag_decimal;
-			parser_parse_decimal(&left->data->decimal, parser);
+			left = parser_push_node(node_tag_decimal, parser);
+			parser_parse_decimal(&program->node_payloads[left].decimal, parser);
 			break;
 
 		case token_tag_equal_sign:
@@ -642,10 +1133,9 @@ node *parser_parse_node(precedence left_precedence, parser *parser)
 			/* skip the operator [if the syntax has one] */
 			if (right_tag != node_tag_invocation) parser_get_token(parser);
 
-			node *right = is_ternary ? PUSH_TRAIN(node, ternary_node, &parser->allocator) : PUSH_TRAIN(node, binary_node, &parser->allocator);
-			right->tag = right_tag;
-			right->data->binary.left = left;
-			right->data->binary.right = parser_parse_node(right_precedence, parser);
+			node_reference right = parser_push_node(right_tag, parser);
+			node_reference right_node = parser_parse_node(right_precedence, parser);
+			program->node_payloads[right].binary = (binary_node){ left, right_node };
 
 			if (is_ternary)
 			{
@@ -653,16 +1143,22 @@ node *parser_parse_node(precedence left_precedence, parser *parser)
 				{
 					/* procedure */
 				case token_tag_left_curly_bracket:
-					right->data->ternary.node = PUSH_TRAIN(node, scope_node, &parser->allocator);
-					right->data->ternary.node->tag = node_tag_scope;
-					parser_parse_scope(&right->data->ternary.node->data->scope, parser);
+				{
+					node_reference scope = parser_push_node(node_tag_scope, parser);
+					scope_node scope_body = parser_parse_scope(0, parser);
+					program->node_payloads[scope].scope = scope_body;
+					program->node_payloads[right].ternary.node = scope;
 					break;
+				}
 
 					/* condition */
 				case token_tag_colon:
+				{
 					parser_get_token(parser); /* skip the `:` */
-					right->data->ternary.node = parser_parse_node(right_precedence, parser);
+					node_reference node = parser_parse_node(right_precedence, parser);
+					program->node_payloads[right].ternary.node = node;
 					break;
+				}
 
 				default:
 					/* the third node of a ternary is omittable, so just continue */
@@ -678,48 +1174,47 @@ finished:
 	return left;
 }
 
-static void display_node(const node *node, uint depth)
+static void display_node(const program *program, node_reference node, uint depth)
 {
-	uintb types[] =
-	{
-#define X(type, identifier, body, syntax) [node_tag_##identifier] = type,
-	#include "code_nodes.inc"
-#undef X
-	};
-
 	for (uint i = 0; i < depth; ++i) printf("  ");
 
 	if (node)
 	{
-		printf("%s: ", node_tag_representations[node->tag]);
+		node_tag tag = program->node_tags[node];
+		const node_payload *payload = &program->node_payloads[node];
+		printf("%s: ", node_tag_representations[tag]);
 
 		depth += 1;
-		switch (types[node->tag])
+		switch (node_types[tag])
 		{
 		case 0:
-			switch (node->tag)
+			switch (tag)
 			{
 			case node_tag_scope:
 				printf("\n");
-				for (uint i = 0; i < node->data->scope.nodes_count; ++i)
+				for (uint i = 0; i < payload->scope.nodes_count; ++i)
 				{
-					display_node(node->data->scope.nodes[i], depth);
+					display_node(program, program->references[payload->scope.references_index + i], depth);
 				}
 				break;
 			case node_tag_identifier:
-				printf("%.*s", node->data->identifier.runes_count, node->data->identifier.runes);
+			{
+				uint runes_count;
+				const utf8 *runes = get_symbol_text(payload->identifier.symbol, &runes_count);
+				printf("%.*s", runes_count, runes);
 				break;
+			}
 			case node_tag_text:
-				printf("%.*s", node->data->identifier.runes_count, node->data->text.runes);
+				printf("\"%.*s\"", payload->text.runes_count, program->constants[payload->text.constant_index].runes);
 				break;
 			case node_tag_digital:
-				printf("%llu", node->data->digital.value);
+				printf("%llu", program->constants[payload->digital.constant_index].digital);
 				break;
 			case node_tag_decimal:
-				printf("%lf", node->data->decimal.value);
+				printf("%lf", program->constants[payload->decimal.constant_index].decimal);
 				break;
 			case node_tag_pragma:
-				switch (node->data->pragma.code)
+				switch (payload->pragma.code)
 				{
 				case pragma_code_none:
 					printf("none");
@@ -729,9 +1224,9 @@ static void display_node(const node *node, uint depth)
 					break;
 				}
 				printf("\n");
-				if (node->data->pragma.node)
+				if (payload->pragma.node)
 				{
-					display_node(node->data->pragma.node, depth);
+					display_node(program, payload->pragma.node, depth);
 				}
 			default:
 				break;
@@ -739,18 +1234,18 @@ static void display_node(const node *node, uint depth)
 			break;
 		case 1:
 			printf("\n");
-			display_node(node->data->unary.node, depth);
+			display_node(program, payload->unary.node, depth);
 			break;
 		case 2:
 			printf("\n");
-			display_node(node->data->binary.left, depth);
-			display_node(node->data->binary.right, depth);
+			display_node(program, payload->binary.left, depth);
+			display_node(program, payload->binary.right, depth);
 			break;
 		case 3:
 			printf("\n");
-			display_node(node->data->ternary.left, depth);
-			display_node(node->data->ternary.right, depth);
-			display_node(node->data->ternary.node, depth);
+			display_node(program, payload->ternary.left, depth);
+			display_node(program, payload->ternary.right, depth);
+			display_node(program, payload->ternary.node, depth);
 			break;
 		}
 	}
@@ -761,31 +1256,172 @@ static void display_node(const node *node, uint depth)
 	printf("\n");
 }
 
-void parser_parse_scope(scope_node *result, parser *parser)
+typedef struct
+{
+	const program *source;
+	program       *result;
+	utf8          *texts_caret;
+} program_compactor;
+
+static scope_node relocate_scope(scope_node scope, program_compactor *compactor);
+
+static node_reference relocate_node(node_reference node, program_compactor *compactor)
+{
+	if (!node) return 0;
+
+	const program *source = compactor->source;
+	program *result = compactor->result;
+	node_tag tag = source->node_tags[node];
+	node_payload payload = source->node_payloads[node];
+
+	/* the node is numbered before the nodes under it */
+	node_reference relocation = result->nodes_count++;
+	result->node_tags[relocation] = tag;
+
+	switch (node_types[tag])
+	{
+	case 0:
+		switch (tag)
+		{
+		case node_tag_scope:
+			payload.scope = relocate_scope(payload.scope, compactor);
+			break;
+		case node_tag_text:
+		{
+			const utf8 *runes = source->constants[payload.text.constant_index].runes;
+			copy(compactor->texts_caret, runes, payload.text.runes_count);
+			payload.text.constant_index = result->constants_count++;
+			result->constants[payload.text.constant_index].runes = compactor->texts_caret;
+			compactor->texts_caret += payload.text.runes_count;
+			break;
+		}
+		case node_tag_digital:
+		case node_tag_decimal:
+		{
+			/* the constant index is first in both */
+			uint constant_index = result->constants_count++;
+			result->constants[constant_index] = source->constants[payload.digital.constant_index];
+			payload.digital.constant_index = constant_index;
+			break;
+		}
+		case node_tag_pragma:
+			payload.pragma.node = relocate_node(payload.pragma.node, compactor);
+			break;
+		default:
+			break;
+		}
+		break;
+	case 1:
+		payload.unary.node = relocate_node(payload.unary.node, compactor);
+		break;
+	case 2:
+		payload.binary.left  = relocate_node(payload.binary.left,  compactor);
+		payload.binary.right = relocate_node(payload.binary.right, compactor);
+		break;
+	case 3:
+		payload.ternary.left  = relocate_node(payload.ternary.left,  compactor);
+		payload.ternary.right = relocate_node(payload.ternary.right, compactor);
+		payload.ternary.node  = relocate_node(payload.ternary.node,  compactor);
+		break;
+	}
+
+	result->node_payloads[relocation] = payload;
+	return relocation;
+}
+
+/* a scope's run of references is laid out before the nodes under it */
+static scope_node relocate_scope(scope_node scope, program_compactor *compactor)
+{
+	program *result = compactor->result;
+	scope_node relocation = { result->references_count, scope.nodes_count };
+	result->references_count += scope.nodes_count;
+	for (uint i = 0; i < scope.nodes_count; ++i)
+	{
+		node_reference node = relocate_node(compactor->source->references[scope.references_index + i], compactor);
+		result->references[relocation.references_index + i] = node;
+	}
+	return relocation;
+}
+
+void compact_program(program *result, const program *program)
+{
+	ZERO(result, 1);
+	regional_allocator *allocator = &result->allocator;
+
+	uint texts_size = 0;
+	for (uint i = 1; i < program->nodes_count; ++i)
+	{
+		if (program->node_tags[i] == node_tag_text) texts_size += program->node_payloads[i].text.runes_count;
+	}
+
+	/* everything is sized exactly, as the counts don't change */
+	result->node_tags     = PUSH_UNINITIALIZED(node_tag,       program->nodes_count,      allocator);
+	result->node_payloads = PUSH_UNINITIALIZED(node_payload,   program->nodes_count,      allocator);
+	result->references    = PUSH_UNINITIALIZED(node_reference, program->references_count, allocator);
+	result->constants     = PUSH_UNINITIALIZED(node_constant,  program->constants_count,  allocator);
+
+	program_compactor compactor = { program, result, PUSH_UNINITIALIZED(utf8, texts_size, allocator) };
+
+	result->node_tags    [0] = node_tag_undefined;
+	result->node_payloads[0] = (node_payload){};
+	result->nodes_count = 1;
+	result->globe = relocate_scope(program->globe, &compactor);
+
+	ASSERT(result->nodes_count      == program->nodes_count);
+	ASSERT(result->references_count == program->references_count);
+	ASSERT(result->constants_count  == program->constants_count);
+}
+
+void program_release(program *program)
+{
+	release_regions(&program->allocator);
+	ZERO(program, 1);
+}
+
+constexpr uint scope_chunk_capacity = 64;
+
+typedef struct scope_chunk scope_chunk;
+struct scope_chunk
+{
+	scope_chunk *next;
+	uint         count;
+	node_reference nodes[scope_chunk_capacity];
+};
+
+/* 
+	the nodes are gathered in chunks on the scratch allocator, as their count isn't known until the end,
+	and then flattened into a run of the program's references. the scopes nest, and so do their temporaries.
+*/
+scope_node parser_parse_scope(bit is_global, parser *parser)
 {
-	bit is_global = result == &parser->program->globe;
 	if (!is_global) ASSERT(parser->token.tag == token_tag_left_curly_bracket);
 
-	uint nodes_capacity = 8;
-	result->nodes = ALLOCATE(node *, nodes_capacity); /* TODO: stop `VirtualAlloc`ing */
-	result->nodes_count = 0;
+	regional_allocator *scratch_allocator = get_scratch_allocator(&parser->allocator);
+	temporary temporary = begin_temporary(scratch_allocator);
+
+	scope_chunk *first_chunk = PUSH_UNINITIALIZED(scope_chunk, 1, scratch_allocator);
+	scope_chunk *chunk = first_chunk;
+	chunk->next  = 0;
+	chunk->count = 0;
+	uint nodes_count = 0;
 
 	parser_get_token(parser); /* get the first token if `is_global`, otherwise, skip the `{` */
-	for (;;)
+	for (uint index = 0;; ++index)
 	{
-		node *current_node = parser_parse_node(0, parser);
+		if (is_global) TRACE_BEGIN("declaration", parser->source_path, index);
+		node_reference current_node = parser_parse_node(0, parser);
+		if (is_global) TRACE_END("declaration", parser->source_path, index);
 		if (current_node)
 		{
-			if (result->nodes_count >= nodes_capacity)
+			if (chunk->count == scope_chunk_capacity)
 			{
-				uint additional_capacity = nodes_capacity / 2;
-				node **new_memory = ALLOCATE(node *, nodes_capacity + additional_capacity);
-				COPY(new_memory, result->nodes, result->nodes_count);
-				DEALLOCATE(result->nodes, nodes_capacity);
-				nodes_capacity += additional_capacity;
-				result->nodes = new_memory;
+				chunk->next = PUSH_UNINITIALIZED(scope_chunk, 1, scratch_allocator);
+				chunk = chunk->next;
+				chunk->next  = 0;
+				chunk->count = 0;
 			}
-			result->nodes[result->nodes_count++] = current_node;
+			chunk->nodes[chunk->count++] = current_node;
+			nodes_count += 1;
 		}
 
 		switch (parser->token.tag)
@@ -814,9 +1450,24 @@ void parser_parse_scope(scope_node *result, parser *parser)
 	}
 
 finished:
+{
+	program *program = parser->program;
+	while (program->references_count + nodes_count > parser->references_capacity)
+	{
+		program->references = grow_pool(program->references, &parser->references_capacity, sizeof(node_reference), &parser->references_allocator);
+	}
+	scope_node result = { program->references_count, nodes_count };
+	for (chunk = first_chunk; chunk; chunk = chunk->next)
+	{
+		COPY(program->references + program->references_count, chunk->nodes, chunk->count);
+		program->references_count += chunk->count;
+	}
+	end_temporary(temporary);
+
 	parser_get_token(parser); /* skip `}`, or ignore ETX */
 
-	return;
+	return result;
+}
 
 failed:
 	jump(*parser->failure_landing, 1);
@@ -824,10 +1475,12 @@ failed:
 
 void parser_parse_identifier(identifier_node *result, parser *parser)
 {
-	result->runes_count = parser->token.ending - parser->token.beginning;
-	const utf8 *source = parser->source + parser->token.beginning;
-	result->runes = (utf8 *)push(result->runes_count, sizeof(void *), &parser->allocator);
-	copy(result->runes, source, result->runes_count);
+	result->symbol = intern_symbol(parser->source + parser->token.beginning, parser->token.ending - parser->token.beginning);
+	if (result->symbol == symbol_none)
+	{
+		parser_report_failure(parser, "Too many distinct identifiers.");
+		jump(*parser->failure_landing, 1);
+	}
 	parser_get_token(parser);
 }
 
@@ -835,13 +1488,98 @@ void parser_parse_text(text_node *result, parser *parser)
 {
 	ASSERT(parser->token.tag == token_tag_text);
 
-	result->runes_count = parser->token.ending - parser->token.beginning;
-	const utf8 *source = parser->source + parser->token.beginning;
-	result->runes = (utf8 *)push(result->runes_count, sizeof(void *), &parser->allocator);
-	copy(result->runes, source, result->runes_count);
+	/* the lexer made sure that every `\\` is followed by something before the closing `"` */
+	const utf8 *source = parser->source + parser->token.beginning + 1;
+	uint source_size = parser->token.ending - parser->token.beginning - 2;
+
+	/* a text without escapes is its source */
+	uint index = scan_text(source, source_size);
+	if (index == source_size)
+	{
+		result->constant_index = parser_push_constant((node_constant){ .runes = source }, parser);
+		result->runes_count    = source_size;
+		result->is_escaped     = 0;
+		parser_get_token(parser);
+		return;
+	}
+
+	/* escapes only ever shrink, so the decoded text fits where the source would */
+	utf8 *runes = (utf8 *)push_uninitialized(source_size, sizeof(void *), &parser->allocator);
+	copy(runes, source, index);
+	utf8 *caret = runes + index;
+	for (;;)
+	{
+		uint run_size = scan_text(source + index, source_size - index);
+		copy(caret, source + index, run_size);
+		caret += run_size;
+		index += run_size;
+		if (index == source_size) break;
+
+		utf8 escaped = source[index + 1];
+		index += 2;
+		switch (escaped)
+		{
+		case '0':  *caret++ = '\0';   break;
+		case 'a':  *caret++ = '\a';   break;
+		case 'b':  *caret++ = '\b';   break;
+		case 'e':  *caret++ = '\x1b'; break;
+		case 'f':  *caret++ = '\f';   break;
+		case 'n':  *caret++ = '\n';   break;
+		case 'r':  *caret++ = '\r';   break;
+		case 't':  *caret++ = '\t';   break;
+		case 'v':  *caret++ = '\v';   break;
+		case '\\': *caret++ = '\\';   break;
+		case '"':  *caret++ = '"';    break;
+		case '\'': *caret++ = '\'';   break;
+		case 'u':
+		{
+			/* `\\u{` 1 to 6 hexadecimal digits `}` */
+			if (source[index] != '{') goto malformed;
+			index += 1;
+			utf32 rune = 0;
+			uint digits_count = 0;
+			for (; index < source_size && source[index] != '_' && is_hexadecimal_byte(source[index]); ++index, ++digits_count)
+			{
+				utf8 digit = source[index];
+				rune = (rune << 4) | (is_digit(digit) ? digit - '0' : (digit | 0x20) - 'a' + 10);
+			}
+			if (source[index] != '}' || !digits_count || digits_count > 6) goto malformed;
+			index += 1;
+			if (rune > 0x10FFFF || (rune >= 0xD800 && rune <= 0xDFFF))
+			{
+				parser_report_failure(parser, "Unencodable rune: U+%X.", rune);
+				jump(*parser->failure_landing, 1);
+			}
+			caret += encode_utf8(caret, rune);
+			break;
+		}
+		default:
+			goto malformed;
+		}
+	}
+
+	result->constant_index = parser_push_constant((node_constant){ .runes = runes }, parser);
+	result->runes_count    = caret - runes;
+	result->is_escaped     = 1;
 	parser_get_token(parser);
+	return;
 
-	/* TODO: handle escape characters */
+malformed:
+	parser_report_failure(parser, "Malformed escape.");
+	jump(*parser->failure_landing, 1);
+}
+
+/* a uint64 has at most 20 decimal, 16 hexadecimal, or 64 binary significant digits */
+constexpr uint maximum_significant_digits_count = 64;
+
+/* converts eight decimal digits at once, by summing neighboring ones into pairs, then quadruples, then the whole */
+static inline uint64 decode_eight_decimal_digits(uint64 chunk)
+{
+	chunk -= 0x3030303030303030;
+	chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FF;
+	chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFF;
+	chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFF;
+	return chunk;
 }
 
 void parser_parse_digital(digital_node *result, parser *parser)
@@ -851,19 +1589,80 @@ void parser_parse_digital(digital_node *result, parser *parser)
 	       || parser->token.tag == token_tag_hexadecimal);
 
 	uintb base;
+	const utf8 *caret = parser->source + parser->token.beginning;
+	const utf8 *ending = parser->source + parser->token.ending;
 	switch (parser->token.tag)
 	{
-	case token_tag_binary:      base = 2;  break;
-	case token_tag_digital:     base = 10; break;
-	case token_tag_hexadecimal: base = 16; break;
+	case token_tag_binary:      base = 2;  caret += 2; break;
+	case token_tag_digital:     base = 10;             break;
+	case token_tag_hexadecimal: base = 16; caret += 2; break;
 	default: UNREACHABLE();
 	}
 
-	utf8 *ending;
-	result->value = strtoull(parser->source + parser->token.beginning, &ending, base);
+	/* gather the significant digits without their separators, so that they are contiguous */
+	utf8 digits[maximum_significant_digits_count];
+	uint digits_count = 0;
+	bit has_digits = 0;
+	for (; caret != ending; ++caret)
+	{
+		utf8 digit = *caret;
+		if (digit == '_') continue;
+		has_digits = 1;
+		if (digit == '0' && !digits_count) continue;
+
+		if (base == 2 && digit > '1')
+		{
+			parser_report_failure(parser, "Unbinary digit: %c.", digit);
+			jump(*parser->failure_landing, 1);
+		}
+		if (digits_count == maximum_significant_digits_count) goto overflowed;
+		digits[digits_count++] = digit;
+	}
+	if (!has_digits)
+	{
+		parser_report_failure(parser, "Digitless number.");
+		jump(*parser->failure_landing, 1);
+	}
+
+	uint64 value = 0;
+	switch (base)
+	{
+	case 2:
+		for (uint i = 0; i < digits_count; ++i) value = (value << 1) | (digits[i] - '0');
+		break;
+	case 16:
+		if (digits_count > 16) goto overflowed;
+		for (uint i = 0; i < digits_count; ++i)
+		{
+			utf8 digit = digits[i];
+			value = (value << 4) | (uint64)(is_digit(digit) ? digit - '0' : (digit | 0x20) - 'a' + 10);
+		}
+		break;
+	case 10:
+	{
+		if (digits_count > 20) goto overflowed;
+		uint i = 0;
+		for (; i + 8 <= digits_count; i += 8)
+		{
+			uint64 chunk;
+			copy(&chunk, digits + i, sizeof(chunk));
+			if (__builtin_mul_overflow(value, 100000000ull, &value) || __builtin_add_overflow(value, decode_eight_decimal_digits(chunk), &value)) goto overflowed;
+		}
+		for (; i < digits_count; ++i)
+		{
+			if (__builtin_mul_overflow(value, 10ull, &value) || __builtin_add_overflow(value, (uint64)(digits[i] - '0'), &value)) goto overflowed;
+		}
+		break;
+	}
+	}
+
+	result->constant_index = parser_push_constant((node_constant){ .digital = value }, parser);
 	parser_get_token(parser);
+	return;
 
-	/* TODO: ditch the C standard library */
+overflowed:
+	parser_report_failure(parser, "Number is too big for 64 bits.");
+	jump(*parser->failure_landing, 1);
 }
 
 void parser_parse_decimal(decimal_node *result, parser *parser)
@@ -871,35 +1670,200 @@ void parser_parse_decimal(decimal_node *result, parser *parser)
 	ASSERT(parser->token.tag == token_tag_decimal
 	       || parser->token.tag == token_tag_scientific);
 
-	utf8 *ending;
-	result->value = strtod(parser->source + parser->token.beginning, &ending);
+	/* both precisions are kept, as which one is wanted isn't known until the pragmas are resolved */
+	real64 value;
+	decode_real_text(&value, &result->value32, parser->source + parser->token.beginning, parser->token.ending - parser->token.beginning);
+	result->constant_index = parser_push_constant((node_constant){ .decimal = value }, parser);
 	parser_get_token(parser);
-	
-	/* TODO: ditch the C standard library */
 }
 
-void parser_parse(const utf8 *source_path, program *program, parser *parser)
+static uintl measure_mass(const regional_allocator *allocator)
+{
+	uintl peak_mass = 0;
+	for (const region *region = allocator->first_region; region; region = region->next) peak_mass += MAXIMUM(region->peak, region->mass);
+	return peak_mass;
+}
+
+static const utf8 *const pragma_names[pragma_codes_count] =
+{
+	[pragma_code_fp64] = "fp64",
+};
+
+void parser_parse(const utf8 *source_path, parser_options options, program *program, parser *parser)
 {
 	ZERO(parser, 1);
+	parser->options = options;
+	parser->allocator.reservation_size               = default_reservation_size_of_regional_allocator;
+	parser->node_tags_allocator.reservation_size     = default_reservation_size_of_regional_allocator;
+	parser->node_payloads_allocator.reservation_size = default_reservation_size_of_regional_allocator;
+	parser->references_allocator.reservation_size    = default_reservation_size_of_regional_allocator;
+	parser->constants_allocator.reservation_size     = default_reservation_size_of_regional_allocator;
+
+	/* a failure jumps out of the temporaries of the scopes it's in, so they're ended all at once here */
+	temporary scratch_temporary = begin_temporary(get_scratch_allocator(&parser->allocator));
+
+	uint trace_depth = TRACE_DEPTH();
+	uintl acquired_regions_count = atomic_load_explicit(&base.acquired_regions_count, memory_order_relaxed);
+	uintl recycled_regions_count = atomic_load_explicit(&base.recycled_regions_count, memory_order_relaxed);
 
 	landing failure_landing;
 	parser->failure_landing = &failure_landing;
 	if (SET_LANDING(failure_landing))
 	{
 		REPORT_FAILURE("Failed to parse.");
-		/* TODO: handle failure here */
+		TRACE_UNWIND(trace_depth);
+		end_temporary(scratch_temporary);
+		parser_end_pipeline(parser);
+		ZERO(program, 1);
+		parser_release(parser);
 		return;
 	}
 
+	ZERO(program, 1);
 	parser->program = program;
-	parser_load(source_path, parser);
-	parser_parse_scope(&parser->program->globe, parser);
-	for (uint i = 0; i < parser->program->globe.nodes_count; ++i)
+	for (pragma_code code = 0; code < pragma_codes_count; ++code)
 	{
-		display_node(parser->program->globe.nodes[i], 0);
+		const utf8 *name = pragma_names[code];
+		parser->pragma_symbols[code] = name ? intern_symbol(name, get_size_of_utf8_text(name)) : symbol_none;
+	}
+	{
+		TRACE_BEGIN("load", source_path, -1);
+		BEGIN_TIMING(parser);
+		parser_load(source_path, parser);
+		END_TIMING(parser, loading_time);
+		TRACE_END("load", source_path, -1);
+	}
+	if (parser->options.pretokenizes)
+	{
+		TRACE_BEGIN("lex", source_path, -1);
+		parser_pretokenize(parser);
+		TRACE_END("lex", source_path, -1);
+	}
+	else if (parser->options.pipelines) parser_begin_pipeline(parser);
+	{
+		/* without pretokenizing or pipelining, lexing interleaves token by token with parsing, so its time is within this span */
+		TRACE_BEGIN("parse", source_path, -1);
+		BEGIN_TIMING(parser);
+		parser_push_node(node_tag_undefined, parser); /* so that no node is referred to as zero */
+		parser->program->globe = parser_parse_scope(1, parser);
+		end_temporary(scratch_temporary);
+		END_TIMING(parser, parsing_time);
+		TRACE_END("parse", source_path, -1);
+	}
+	parser_end_pipeline(parser);
+	{
+		parser_statistics *statistics = &parser->statistics;
+		statistics->acquired_regions_count = atomic_load_explicit(&base.acquired_regions_count, memory_order_relaxed) - acquired_regions_count;
+		statistics->recycled_regions_count = atomic_load_explicit(&base.recycled_regions_count, memory_order_relaxed) - recycled_regions_count;
+		statistics->peak_mass  = measure_mass(&parser->allocator);
+		statistics->peak_mass += measure_mass(&parser->node_tags_allocator);
+		statistics->peak_mass += measure_mass(&parser->node_payloads_allocator);
+		statistics->peak_mass += measure_mass(&parser->references_allocator);
+		statistics->peak_mass += measure_mass(&parser->constants_allocator);
+	}
+	if (parser->options.compacts)
+	{
+		TRACE_BEGIN("compact", source_path, -1);
+		BEGIN_TIMING(parser);
+		typeof(*program) compacted_program;
+		compact_program(&compacted_program, program);
+		parser_release(parser);
+		*program = compacted_program;
+		END_TIMING(parser, compacting_time);
+		TRACE_END("compact", source_path, -1);
+
+		parser->statistics.compacted_mass = measure_mass(&program->allocator);
+	}
+	{
+		TRACE_BEGIN("display", source_path, -1);
+		BEGIN_TIMING(parser);
+		for (uint i = 0; i < program->globe.nodes_count; ++i)
+		{
+			display_node(program, program->references[program->globe.references_index + i], 0);
+		}
+		END_TIMING(parser, displaying_time);
+		TRACE_END("display", source_path, -1);
+	}
+	if (parser->options.collects_statistics)
+	{
+		/* every node but the undefined one is in the tree, so they're counted without walking it */
+		for (uint i = 1; i < program->nodes_count; ++i) parser->statistics.nodes_counts[program->node_tags[i]] += 1;
 	}
-
-	
 
 	REPORT_VERBOSE("Finished parsing.\n");
 }
+
+void parser_report_statistics(const parser *parser, bit as_line)
+{
+	const parser_statistics *statistics = &parser->statistics;
+	uintl peak_mass = statistics->peak_mass;
+
+	uintl tokens_count = 0;
+	for (uint i = 0; i < COUNT(statistics->tokens_counts); ++i) tokens_count += statistics->tokens_counts[i];
+	uintl nodes_count = 0;
+	for (uint i = 0; i < COUNT(statistics->nodes_counts); ++i) nodes_count += statistics->nodes_counts[i];
+
+	if (as_line)
+	{
+		fprintf(stderr, "statistics loading_time=%llu lexing_time=%llu parsing_time=%llu displaying_time=%llu bytes_read=%u tokens=%llu nodes=%llu regions_acquired=%llu regions_recycled=%llu peak_mass=%llu",
+			(unsigned long long)statistics->loading_time, (unsigned long long)statistics->lexing_time, (unsigned long long)statistics->parsing_time, (unsigned long long)statistics->displaying_time,
+			parser->source_size, (unsigned long long)tokens_count, (unsigned long long)nodes_count,
+			(unsigned long long)statistics->acquired_regions_count, (unsigned long long)statistics->recycled_regions_count, (unsigned long long)peak_mass);
+		if (parser->options.compacts)
+		{
+			fprintf(stderr, " compacting_time=%llu compacted_mass=%llu", (unsigned long long)statistics->compacting_time, (unsigned long long)statistics->compacted_mass);
+		}
+		for (uint i = 0; i < COUNT(statistics->tokens_counts); ++i)
+		{
+			if (statistics->tokens_counts[i]) fprintf(stderr, " token_%s=%llu", token_tag_identifiers[i], (unsigned long long)statistics->tokens_counts[i]);
+		}
+		for (uint i = 0; i < COUNT(statistics->nodes_counts); ++i)
+		{
+			if (statistics->nodes_counts[i]) fprintf(stderr, " node_%s=%llu", node_tag_representations[i], (unsigned long long)statistics->nodes_counts[i]);
+		}
+		fputc('\n', stderr);
+		return;
+	}
+
+	fprintf(stderr, "[%s] Statistics of %s:\n", severity_representations[severity_comment], parser->source_path);
+	fprintf(stderr, "\t%-24s %14.3f ms\n", "loading",                statistics->loading_time    / 1e6);
+	fprintf(stderr, "\t%-24s %14.3f ms\n", "lexing",                 statistics->lexing_time     / 1e6);
+	fprintf(stderr, "\t%-24s %14.3f ms\n", "parsing (with lexing)",  statistics->parsing_time    / 1e6);
+	if (parser->options.compacts)
+	{
+		fprintf(stderr, "\t%-24s %14.3f ms\n", "compacting",         statistics->compacting_time / 1e6);
+	}
+	fprintf(stderr, "\t%-24s %14.3f ms\n", "displaying",             statistics->displaying_time / 1e6);
+	fprintf(stderr, "\t%-24s %14u\n",      "bytes read",             parser->source_size);
+	fprintf(stderr, "\t%-24s %14llu\n",    "regions acquired",       (unsigned long long)statistics->acquired_regions_count);
+	fprintf(stderr, "\t%-24s %14llu\n",    "  from the pool",        (unsigned long long)statistics->recycled_regions_count);
+	fprintf(stderr, "\t%-24s %14llu\n",    "peak mass",              (unsigned long long)peak_mass);
+	if (parser->options.compacts)
+	{
+		fprintf(stderr, "\t%-24s %14llu\n",    "compacted mass",     (unsigned long long)statistics->compacted_mass);
+	}
+	fprintf(stderr, "\t%-24s %14llu\n",    "tokens",                 (unsigned long long)tokens_count);
+	for (uint i = 0; i < COUNT(statistics->tokens_counts); ++i)
+	{
+		if (statistics->tokens_counts[i]) fprintf(stderr, "\t  %-22s %14llu\n", token_tag_representations[i], (unsigned long long)statistics->tokens_counts[i]);
+	}
+	fprintf(stderr, "\t%-24s %14llu\n",    "nodes",                  (unsigned long long)nodes_count);
+	for (uint i = 0; i < COUNT(statistics->nodes_counts); ++i)
+	{
+		if (statistics->nodes_counts[i]) fprintf(stderr, "\t  %-22s %14llu\n", node_tag_representations[i], (unsigned long long)statistics->nodes_counts[i]);
+	}
+}
+
+void parser_release(parser *parser)
+{
+	if (parser->source_is_mapped) unmap_file(parser->source, parser->source_size);
+	parser->source = 0;
+	parser->source_is_mapped = 0;
+	release_regions(&parser->allocator);
+	release_regions(&parser->lines_allocator);
+	ZERO(&parser->lines, 1);
+	release_regions(&parser->node_tags_allocator);
+	release_regions(&parser->node_payloads_allocator);
+	release_regions(&parser->references_allocator);
+	release_regions(&parser->constants_allocator);
+}
@@ -5,14 +5,21 @@
 
 typedef enum : uintb
 {
-#define X(identifier, code, representation) token_tag_##identifier = code,
+#define X(identifier, code, representation, prefix, suffix) token_tag_##identifier = code,
 	#include "code_tokens.inc"
 #undef X
 } token_tag;
 
 constexpr utf8 token_tag_representations[][40] =
 {
-#define X(identifier, code, representation) [token_tag_##identifier] = representation,
+#define X(identifier, code, representation, prefix, suffix) [token_tag_##identifier] = representation,
+	#include "code_tokens.inc"
+#undef X
+};
+
+constexpr utf8 token_tag_identifiers[][40] =
+{
+#define X(identifier, code, representation, prefix, suffix) [token_tag_##identifier] = #identifier,
 	#include "code_tokens.inc"
 #undef X
 };
@@ -22,10 +29,24 @@ typedef struct
 	token_tag tag;
 	uint beginning;
 	uint ending;
-	uint row;
-	uint column;
 } token;
 
+/* passes tokens from a lexing thread to a parsing one */
+typedef struct token_ring token_ring;
+
+/* 
+	the tokens of a whole source, in parallel arrays. endings can't be found from the next beginnings,
+	as whitespace and comments are between them, so the lengths are kept in a byte each. a token as long
+	as `uint8_maximum` or longer is lexed again for its ending.
+*/
+typedef struct
+{
+	token_tag *tags;
+	uint      *beginnings;
+	uint8     *lengths;
+	uint       count; /* the last one is always an etx */
+} token_stream;
+
 typedef enum : uintb 
 {
 #define X(type, identifier, body, syntax) node_tag_##identifier,
@@ -47,7 +68,24 @@ constexpr utf8 node_syntaxes[][40] =
 #undef X
 };
 
-typedef struct node node;
+/* the count of nodes a node refers to, or zero when its payload is particular to it */
+constexpr uintb node_types[] =
+{
+#define X(type, identifier, body, syntax) [node_tag_##identifier] = type,
+	#include "code_nodes.inc"
+#undef X
+};
+
+/* an index into the nodes of a program, where zero is no node */
+typedef uint32 node_reference;
+
+/* the values too wide for a node's payload */
+typedef union
+{
+	uint64      digital;
+	real64      decimal;
+	const utf8 *runes;
+} node_constant;
 
 typedef enum
 {
@@ -55,50 +93,141 @@ typedef enum
 	pragma_code_fp64,
 } pragma_code;
 
+constexpr uint pragma_codes_count = pragma_code_fp64 + 1;
+
 #define X(type, identifier, body, syntax) typedef struct identifier##_node body identifier##_node;
 	#include "code_nodes.inc"
 #undef X
 
-struct node
+typedef union
 {
-	node_tag tag;
-	union
-	{
 #define X(type, identifier, body, syntax) identifier##_node identifier;
 	#include "code_nodes.inc"
 #undef X
-	} data[];
-};
+} node_payload;
 
+static_assert(sizeof(node_payload) == 12);
+
+/* the tags and the payloads of the nodes are apart, and the first node is the undefined one */
 typedef struct
 {
+	node_tag     *node_tags;
+	node_payload *node_payloads;
+	uint          nodes_count;
+
+	node_reference *references;
+	uint            references_count;
+
+	node_constant *constants;
+	uint           constants_count;
+
 	scope_node globe;
+
+	regional_allocator allocator; /* only a compacted program owns its memory, otherwise the parser does */
 } program;
 
+/* 
+	relocates a program into its own memory in pre-order, so that a walk of the tree goes through the nodes,
+	the references and the constants in the order they're laid out. the texts are packed together, so
+	nothing refers into the source anymore.
+*/
+void compact_program(program *result, const program *program);
+
+/* releases the memory of a compacted program, and does nothing for one that the parser owns */
+void program_release(program *program);
+
+typedef struct
+{
+	bit collects_statistics : 1;
+	bit pretokenizes        : 1; /* lexes the whole source before parsing any of it */
+	bit pipelines           : 1; /* lexes on another thread while parsing, unless pretokenizing */
+	bit compacts            : 1; /* compacts the program once parsed, and releases the parser's memory and the source */
+} parser_options;
+
+typedef struct
+{
+	uintl loading_time;
+	uintl lexing_time;
+	uintl parsing_time; /* including lexing */
+	uintl compacting_time;
+	uintl displaying_time;
+
+	/* of the parse, including its lexer's and its scratch regions */
+	uintl acquired_regions_count;
+	uintl recycled_regions_count;
+
+	/* measured before compacting */
+	uintl peak_mass;
+	uintl compacted_mass;
+
+	uintl tokens_counts[256];
+	uintl nodes_counts[COUNT(node_tag_representations)];
+} parser_statistics;
+
+/* the offsets at which the lines of a source begin */
+typedef struct
+{
+	uint *beginnings;
+	uint  count;
+} line_index;
+
+void build_line_index(const utf8 *source, uint source_size, line_index *result, regional_allocator *allocator);
+
+/* finds the row and column of an offset, both counted from one */
+void locate_in_line_index(uint offset, const utf8 *source, const line_index *lines, uint *row, uint *column);
+
 typedef struct
 {
 	regional_allocator allocator;
 
+	parser_options    options;
+	parser_statistics statistics;
+
 	const utf8 *source_path;
 	uint        source_size;
-	utf8       *source;
+	const utf8 *source; /* the identifiers and texts refer into this, so it's kept until the parser's released */
+	line_index  lines;  /* built on the first report */
+
+	/* the line index is alone on this, so that a temporary taken around code that reports can't pop it */
+	regional_allocator lines_allocator;
 
 	uint position;
-	uint row;
-	uint column;
 
 	utf32 rune;
 	uintb increment;
 
 	bit parsing_finished : 1;
+	bit source_is_mapped : 1;
 
 	landing *failure_landing;
 
+	token_stream tokens; /* only when pretokenizing */
+	uint         next_token_index;
+
+	token_ring *token_ring; /* only when pipelining */
+
 	token       token;
 	program    *program;
 	scope_node *current_scope;
+
+	/* the arrays of the program grow in place, each alone on its allocator */
+	regional_allocator node_tags_allocator;
+	regional_allocator node_payloads_allocator;
+	regional_allocator references_allocator;
+	regional_allocator constants_allocator;
+	uint               nodes_capacity;
+	uint               references_capacity;
+	uint               constants_capacity;
+
+	symbol pragma_symbols[pragma_codes_count];
 } parser;
 
-void parser_parse(const utf8 *source_path, program *program, parser *parser);
+void parser_parse(const utf8 *source_path, parser_options options, program *program, parser *parser);
+
+/* prints the statistics as a table, or as one line of `key=value`s */
+void parser_report_statistics(const parser *parser, bit as_line);
+
+/* releases the source and everything that was parsed from it */
+void parser_release(parser *parser);
 
 #endif
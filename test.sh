@@ -0,0 +1,10 @@
+#!/bin/sh
+set -e
+
+mkdir -p build
+
+CFLAGS="-std=c23 -g -Wno-static-in-inline"
+LFLAGS=""
+
+clang $CFLAGS -o build/symbols tests/symbols.c $LFLAGS
+build/symbols
@@ -0,0 +1,57 @@
+/* 
+	interns the same names from several threads at once, each in its own order, and checks that the threads
+	agree on every symbol, that the symbols are dense, and that their texts read back. test.sh builds and
+	runs it.
+*/
+#define main code_main /* the compiler's own, which isn't run here */
+#include "../code/code.c"
+#undef main
+
+constexpr uint threads_count        = 4;
+constexpr uint names_count          = 200000;
+constexpr uint distinct_names_count = 150000; /* so that a thread meets some names twice */
+
+static utf8   names[names_count][16];
+static symbol symbols[threads_count][names_count];
+
+static int intern_names(void *argument)
+{
+	uint thread = (uint)(uintptr_t)argument;
+
+	/* the strides are prime to the count, so each thread goes over every name, but they race on different ones */
+	uint stride = (uint[]){ 1, 3, 7, 9 }[thread];
+	for (uint i = 0; i < names_count; ++i)
+	{
+		uint name = (uint)((uintl)i * stride % names_count);
+		symbols[thread][name] = intern_symbol(names[name], get_size_of_utf8_text(names[name]));
+	}
+	return 0;
+}
+
+int main(void)
+{
+	for (uint i = 0; i < names_count; ++i) format_text(names[i], sizeof(names[i]), "name%u", i % distinct_names_count);
+
+	thrd_t threads[threads_count];
+	for (uint i = 0; i < threads_count; ++i) thrd_create(&threads[i], intern_names, (void *)(uintptr_t)i);
+	for (uint i = 0; i < threads_count; ++i) thrd_join(threads[i], 0);
+
+	static bit is_seen[distinct_names_count];
+	uint failures_count = 0;
+	for (uint i = 0; i < names_count; ++i)
+	{
+		symbol interned = symbols[0][i];
+		for (uint thread = 1; thread < threads_count; ++thread) failures_count += symbols[thread][i] != interned;
+
+		if (i >= distinct_names_count) failures_count += interned != symbols[0][i - distinct_names_count];
+		else if (interned >= distinct_names_count || is_seen[interned]) failures_count += 1;
+		else is_seen[interned] = 1;
+
+		uint size;
+		const utf8 *text = get_symbol_text(interned, &size);
+		failures_count += size != get_size_of_utf8_text(names[i]) || compare_sized_text(text, names[i], size) != 0;
+	}
+
+	printf("%u names interned by %u threads, %u failures\n", names_count, threads_count, failures_count);
+	return failures_count != 0;
+}